@@ -0,0 +1,452 @@
+/*
+
+ BENCHMARK
+
+ Range-Based for loop with counter variable
+
+ ***********************************************************************************
+ The zlib License
+
+ Copyright ©2023 Marc Schöndorf
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use of
+ this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1.  The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a product,
+     an acknowledgment in the product documentation would be appreciated but is
+     not required.
+
+ 2.  Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+ 3.  This notice may not be removed or altered from any source distribution.
+ ***********************************************************************************
+
+*/
+
+// Compares count()/rcount() against hand written index and iterator loops.
+// Reports the time per element and the number of heap allocations per loop.
+// Compile with optimizations, for example:
+// g++ -std=c++20 -O2 -o Benchmark Benchmark.cpp
+// g++ -std=c++20 -O3 -march=native -o Benchmark Benchmark.cpp
+
+#include "RangeForLoopWithCounter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace RBFLCounter;
+
+//*************************************************************
+// Allocation counting
+static std::size_t g_Allocations = 0;
+
+// Not inlined, otherwise GCC sees malloc/free paired with new/delete and warns (-Wmismatched-new-delete)
+#if defined(__GNUC__) || defined(__clang__)
+    #define BENCHMARK_NOINLINE [[gnu::noinline]]
+#elif defined(_MSC_VER)
+    #define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+    #define BENCHMARK_NOINLINE
+#endif
+
+BENCHMARK_NOINLINE void* operator new(std::size_t size)
+{
+    g_Allocations++;
+    
+    if(void* ptr = std::malloc(size))
+        return ptr;
+    
+    throw std::bad_alloc();
+}
+
+BENCHMARK_NOINLINE void operator delete(void* ptr) noexcept { std::free(ptr); }
+BENCHMARK_NOINLINE void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+//*************************************************************
+// Keep the compiler from removing the benchmarked loops
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile T sink;
+    sink = value;
+#endif
+}
+
+//*************************************************************
+// Runs 'loop' several times and prints the best time per element and the allocations per run
+template<typename Loop>
+void Run(const char* name, const std::size_t& elements, Loop&& loop)
+{
+    constexpr int runs = 20;
+    
+    double bestNanoseconds = 1e300;
+    std::size_t allocations = 0;
+    
+    for(int run = 0; run < runs; run++)
+    {
+        const std::size_t allocationsBefore = g_Allocations;
+        const auto start = std::chrono::steady_clock::now();
+        
+        loop();
+        
+        const auto stop = std::chrono::steady_clock::now();
+        allocations = g_Allocations - allocationsBefore;
+        
+        const double nanoseconds = std::chrono::duration<double, std::nano>(stop - start).count();
+        if(nanoseconds < bestNanoseconds)
+            bestNanoseconds = nanoseconds;
+    }
+    
+    std::printf("  %-50s %8.3f ns/element %6zu allocations\n", name, bestNanoseconds / static_cast<double>(elements), allocations);
+}
+
+//*************************************************************
+// std::vector<int>
+void BenchmarkVectorInt(const std::size_t& size)
+{
+    std::printf("std::vector<int> (%zu elements)\n", size);
+    
+    std::vector<int> vec(size);
+    for(std::size_t i = 0; i < size; i++)
+        vec[i] = static_cast<int>(i % 1000);
+    
+    Run("raw index loop", size, [&]
+    {
+        int64_t sum = 0;
+        for(std::size_t i = 0; i < vec.size(); i++)
+            sum += vec[i] * static_cast<int64_t>(i);
+        DoNotOptimize(sum);
+    });
+    
+    Run("iterator loop", size, [&]
+    {
+        int64_t sum = 0;
+        int64_t i = 0;
+        for(auto it = vec.begin(); it != vec.end(); ++it, ++i)
+            sum += *it * i;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(vec)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(vec))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(vec, 100)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(vec, 100))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(vec, 0, ReverseIndex)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(vec, 0, ReverseIndex))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(vec, 0, true) (run time direction)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(vec, 0, true))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("raw reverse index loop", size, [&]
+    {
+        int64_t sum = 0;
+        for(std::size_t i = vec.size(); i-- > 0;)
+            sum += vec[i] * static_cast<int64_t>(vec.size() - 1 - i);
+        DoNotOptimize(sum);
+    });
+    
+    Run("rcount(vec)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : rcount(vec))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count<int32_t>(vec)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count<int32_t>(vec))
+            sum += value * static_cast<int64_t>(index);
+        DoNotOptimize(sum);
+    });
+}
+
+//*************************************************************
+// std::vector<std::string>
+void BenchmarkVectorString(const std::size_t& size)
+{
+    std::printf("std::vector<std::string> (%zu elements)\n", size);
+    
+    std::vector<std::string> vec(size, "A string long enough to not fit into SSO");
+    
+    Run("raw index loop", size, [&]
+    {
+        std::size_t sum = 0;
+        for(std::size_t i = 0; i < vec.size(); i++)
+            sum += vec[i].size() + i;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(vec)", size, [&]
+    {
+        std::size_t sum = 0;
+        for(auto [value, index] : count(vec))
+            sum += value.size() + static_cast<std::size_t>(index);
+        DoNotOptimize(sum);
+    });
+    
+    Run("rcount(vec, 0, ReverseIndex)", size, [&]
+    {
+        std::size_t sum = 0;
+        for(auto [value, index] : rcount(vec, 0, ReverseIndex))
+            sum += value.size() + static_cast<std::size_t>(index);
+        DoNotOptimize(sum);
+    });
+}
+
+//*************************************************************
+// std::list<int>
+void BenchmarkList(const std::size_t& size)
+{
+    std::printf("std::list<int> (%zu elements)\n", size);
+    
+    std::list<int> list;
+    for(std::size_t i = 0; i < size; i++)
+        list.push_back(static_cast<int>(i % 1000));
+    
+    Run("iterator loop", size, [&]
+    {
+        int64_t sum = 0;
+        int64_t i = 0;
+        for(auto it = list.begin(); it != list.end(); ++it, ++i)
+            sum += *it * i;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(list)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(list))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("rcount(list, 0, ReverseIndex)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : rcount(list, 0, ReverseIndex))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(list.begin(), list.end(), 0, ReverseIndex)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(list.begin(), list.end(), 0, ReverseIndex))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+}
+
+//*************************************************************
+// std::map<int, int>
+void BenchmarkMap(const std::size_t& size)
+{
+    std::printf("std::map<int, int> (%zu elements)\n", size);
+    
+    std::map<int, int> map;
+    for(std::size_t i = 0; i < size; i++)
+        map[static_cast<int>(i)] = static_cast<int>(i % 1000);
+    
+    Run("iterator loop", size, [&]
+    {
+        int64_t sum = 0;
+        int64_t i = 0;
+        for(auto it = map.begin(); it != map.end(); ++it, ++i)
+            sum += it->second * i;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(map)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [element, index] : count(map))
+            sum += element.second * index;
+        DoNotOptimize(sum);
+    });
+}
+
+//*************************************************************
+// C-style array
+void BenchmarkCArray()
+{
+    constexpr std::size_t size = 4096;
+    static int arr[size];
+    
+    std::printf("C-style array (%zu elements)\n", size);
+    
+    for(std::size_t i = 0; i < size; i++)
+        arr[i] = static_cast<int>(i % 1000);
+    
+    Run("raw index loop", size, [&]
+    {
+        int64_t sum = 0;
+        for(std::size_t i = 0; i < size; i++)
+            sum += arr[i] * static_cast<int64_t>(i);
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(arr)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(arr))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("rcount(arr, 100, ReverseIndex)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : rcount(arr, 100, ReverseIndex))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+}
+
+//*************************************************************
+// r-Values and initializer lists
+void BenchmarkRValues(const std::size_t& size)
+{
+    std::printf("r-Value std::vector<int> (%zu elements, includes creating the vector)\n", size);
+    
+    Run("raw index loop over temporary vector", size, [&]
+    {
+        std::vector<int> vec(size, 1);
+        int64_t sum = 0;
+        for(std::size_t i = 0; i < vec.size(); i++)
+            sum += vec[i] * static_cast<int64_t>(i);
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(std::vector<int>(...))", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(std::vector<int>(size, 1)))
+            sum += value * index;
+        DoNotOptimize(sum);
+    });
+    
+    std::printf("r-Value std::initializer_list<int> (8 elements, 100000 loops)\n");
+    
+    Run("raw index loop over local array", 8 * 100000, [&]
+    {
+        int64_t sum = 0;
+        for(int loop = 0; loop < 100000; loop++)
+        {
+            const int arr[] = {loop, 2, 3, 4, 5, 6, 7, 8};
+            for(std::size_t i = 0; i < 8; i++)
+                sum += arr[i] * static_cast<int64_t>(i);
+        }
+        DoNotOptimize(sum);
+    });
+    
+    Run("count({...})", 8 * 100000, [&]
+    {
+        int64_t sum = 0;
+        for(int loop = 0; loop < 100000; loop++)
+            for(auto [value, index] : count({loop, 2, 3, 4, 5, 6, 7, 8}))
+                sum += value * index;
+        DoNotOptimize(sum);
+    });
+}
+
+//*************************************************************
+// Sparse hits, count_if
+void BenchmarkFilter(const std::size_t& size)
+{
+    std::printf("std::vector<int> sparse hits, 1 in 4096 (%zu elements)\n", size);
+    
+    std::vector<int> vec(size, 0);
+    for(std::size_t i = 0; i < size; i += 4096)
+        vec[i] = 1;
+    
+    Run("raw index loop with branch", size, [&]
+    {
+        int64_t sum = 0;
+        for(std::size_t i = 0; i < vec.size(); i++)
+            if(vec[i] != 0)
+                sum += static_cast<int64_t>(i);
+        DoNotOptimize(sum);
+    });
+    
+    Run("count(vec) with branch", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count(vec))
+            if(value != 0)
+                sum += index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("count_if(vec, value != 0)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : count_if(vec, [](const int& value) { return value != 0; }))
+            sum += index;
+        DoNotOptimize(sum);
+    });
+    
+    Run("rcount_if(vec, value != 0, 0, ReverseIndex)", size, [&]
+    {
+        int64_t sum = 0;
+        for(auto [value, index] : rcount_if(vec, [](const int& value) { return value != 0; }, 0, ReverseIndex))
+            sum += index;
+        DoNotOptimize(sum);
+    });
+}
+
+int main()
+{
+    std::printf("Range-Based for loop with counter - Benchmark\n");
+    std::printf("-----------------------------------------------\n");
+    
+    BenchmarkVectorInt(1 << 20);
+    BenchmarkVectorString(1 << 16);
+    BenchmarkList(1 << 18);
+    BenchmarkMap(1 << 16);
+    BenchmarkCArray();
+    BenchmarkRValues(1 << 16);
+    BenchmarkFilter(1 << 24);
+    
+    return 0;
+}
@@ -35,13 +35,91 @@
 
 #include "RangeForLoopWithCounter.h"
 
+#include <array>
 #include <iostream>
 #include <vector>
 #include <list>
 #include <map>
+#include <memory>
+#include <ranges>
 
 using namespace RBFLCounter;
 
+// Compile time example: count() can be used in constant expressions, e.g. for generating lookup tables
+constexpr std::array<int, 8> MakeSquareTable()
+{
+    std::array<int, 8> table{};
+    
+    for(auto [value, index] : count(table))
+        value = static_cast<int>(index * index);
+    
+    return table;
+}
+
+constexpr int64_t SumOfProducts(const bool reverseIndex)
+{
+    int64_t sum = 0;
+    
+    for(auto [value, index] : rcount({1, 2, 3, 4}, 10, reverseIndex))
+        sum += value * index;
+    
+    return sum;
+}
+
+static_assert(MakeSquareTable()[3] == 9);
+static_assert(SumOfProducts(false) == 4 * 10 + 3 * 11 + 2 * 12 + 1 * 13);
+static_assert(SumOfProducts(true) == 4 * 13 + 3 * 12 + 2 * 11 + 1 * 10);
+
+// Element type that counts how often it gets copied or moved, to check that count() and rcount() never copy or move elements
+struct CopyMoveCounter
+{
+    int copies = 0;
+    int moves  = 0;
+};
+
+struct TrackedElement
+{
+    CopyMoveCounter* counter;
+    int value;
+    
+    constexpr TrackedElement(CopyMoveCounter* counter, int value) : counter(counter), value(value) {}
+    constexpr TrackedElement(const TrackedElement& other) : counter(other.counter), value(other.value) { counter->copies++; }
+    constexpr TrackedElement(TrackedElement&& other) noexcept : counter(other.counter), value(other.value) { counter->moves++; }
+    constexpr TrackedElement& operator=(const TrackedElement& other) { counter = other.counter; value = other.value; counter->copies++; return *this; }
+    constexpr TrackedElement& operator=(TrackedElement&& other) noexcept { counter = other.counter; value = other.value; counter->moves++; return *this; }
+};
+
+constexpr std::vector<TrackedElement> MakeTrackedElements(CopyMoveCounter& counter)
+{
+    std::vector<TrackedElement> elements;
+    elements.reserve(3);
+    
+    for(int i = 1; i <= 3; i++)
+        elements.emplace_back(&counter, i);
+    
+    counter = {};
+    return elements;
+}
+
+constexpr bool ElementsNeverCopiedOrMoved()
+{
+    CopyMoveCounter forwardCounter, reverseCounter;
+    int64_t sum = 0;
+    
+    std::vector<TrackedElement> elements = MakeTrackedElements(forwardCounter);
+    for(auto [element, index] : count(std::move(elements)))
+        sum += element.value * index;
+    
+    for(auto [element, index] : rcount(MakeTrackedElements(reverseCounter)))
+        sum += element.value * index;
+    
+    return sum == (1 * 0 + 2 * 1 + 3 * 2) + (3 * 0 + 2 * 1 + 1 * 2)
+       and forwardCounter.copies == 0 and forwardCounter.moves == 0
+       and reverseCounter.copies == 0 and reverseCounter.moves == 0;
+}
+
+static_assert(ElementsNeverCopiedOrMoved());
+
 // Move semantics example
 void RValueMoveExample(std::vector<int>&& v)
 {
@@ -53,6 +131,21 @@ void RValueMoveExample(std::vector<int>&& v)
     std::cout << std::endl << "-----------------------------------------------" << std::endl;
 }
 
+// Move-only element types: the r-Value container is moved into count(), no element gets copied
+void MoveOnlyExample()
+{
+    std::cout << "std::vector<std::unique_ptr<int>> (r-Value, move-only elements)" << std::endl << std::endl;
+    
+    std::vector<std::unique_ptr<int>> ptrs;
+    ptrs.push_back(std::make_unique<int>(10));
+    ptrs.push_back(std::make_unique<int>(20));
+    
+    for(auto [value, index] : count(std::move(ptrs)))
+        std::cout << index << ": " << *value << std::endl;
+    
+    std::cout << std::endl << "-----------------------------------------------" << std::endl;
+}
+
 // Example of all possible reverse modes
 void ReverseExample()
 {
@@ -83,7 +176,7 @@ void ReverseExample()
     // Reverse index counting (count())
     std::cout << "Vector: Reverse index counting (count())" << std::endl << std::endl;
     
-    for(auto [value, index] : count(vec, 0, true))
+    for(auto [value, index] : count(vec, 0, ReverseIndex)) // Direction selected at compile time. A bool (true) selects it at run time
         std::cout << index << ": " << value << std::endl;
     
     std::cout << std::endl << "***********************************************" << std::endl;
@@ -176,6 +269,10 @@ int main()
     // Move semantics example
     RValueMoveExample(std::vector<int>{1, 2});
     
+    //*************************************************************
+    // Move-only elements example
+    MoveOnlyExample();
+    
     //*************************************************************
     // Associative container: std::map example
     std::cout << "std::map" << std::endl << std::endl;
@@ -185,6 +282,28 @@ int main()
     for(auto [element, index] : count(testMap))
         std::cout << index << ": Map(" << element.first << ", " << element.second << ")" << std::endl;
     
+    std::cout << std::endl << "-----------------------------------------------" << std::endl;
+    
+    //*************************************************************
+    // std::ranges pipeline example: index the filtered elements, starting at 100
+    std::cout << "std::ranges pipeline" << std::endl << std::endl;
+    
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    
+    for(auto [value, index] : numbers | std::views::filter([](int n) { return n % 2 == 0; }) | views::counted_enumerate(100) | std::views::take(3))
+        std::cout << index << ": " << value << std::endl;
+    
+    std::cout << std::endl << "-----------------------------------------------" << std::endl;
+    
+    //*************************************************************
+    // Lookup table generated at compile time
+    std::cout << "Compile time lookup table" << std::endl << std::endl;
+    
+    constexpr std::array<int, 8> squares = MakeSquareTable();
+    
+    for(auto [value, index] : count(squares))
+        std::cout << index << ": " << value << std::endl;
+    
     //*************************************************************
     // Different reverse mode examples
     ReverseExample();
@@ -33,20 +33,90 @@
 #ifndef RANGE_FOR_LOOP_WITH_COUNTER_H
 #define RANGE_FOR_LOOP_WITH_COUNTER_H
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <ranges>
 #include <span>
+#include <stdexcept>
+#include <tuple>
 #include <vector>
 #include <initializer_list>
+#include <utility>
 
 //*******************************************************************************
 // Settings
-// Force using 64 bit integers for offsets and counters. If disabled, platform specific maximum size is used (std::size_t or std::ptrdiff_t for signed support).
-#define RBFL_FORCE_64BIT_COUNTER
+// The settings can be overridden by defining them (to 0 or 1) before including this header. Defining them without
+// a value enables them.
+// They only select the default index type. Every count function also accepts the index type as first
+// template parameter, e.g. count<std::int32_t>(...), which takes precedence over these settings.
+
+// Force using 64 bit integers for offsets and counters. If disabled, the platform specific maximum size of the
+// container is used (its size_type, or difference_type for signed support).
+#ifndef RBFL_FORCE_64BIT_COUNTER
+    #define RBFL_FORCE_64BIT_COUNTER 1
+#elif (RBFL_FORCE_64BIT_COUNTER + 0) == 0 && (0 - RBFL_FORCE_64BIT_COUNTER - 1) == 1
+    // Defined without a value ('#define RBFL_FORCE_64BIT_COUNTER'), treat it as enabled
+    #undef RBFL_FORCE_64BIT_COUNTER
+    #define RBFL_FORCE_64BIT_COUNTER 1
+#endif
 
 // Only enable if RBFL_FORCE_64BIT_COUNTER is enabled or you absolutely know what you're doing.
 // If you enable this setting without RBFL_FORCE_64BIT_COUNTER, it is possible that the index counter variable
 // overflows when using very large containers or arrays.
-#define RBFL_ENABLE_SIGNED_COUNTER
+#ifndef RBFL_ENABLE_SIGNED_COUNTER
+    #define RBFL_ENABLE_SIGNED_COUNTER 1
+#elif (RBFL_ENABLE_SIGNED_COUNTER + 0) == 0 && (0 - RBFL_ENABLE_SIGNED_COUNTER - 1) == 1
+    // Defined without a value ('#define RBFL_ENABLE_SIGNED_COUNTER'), treat it as enabled
+    #undef RBFL_ENABLE_SIGNED_COUNTER
+    #define RBFL_ENABLE_SIGNED_COUNTER 1
+#endif
+
+// Define RBFL_ENABLE_PARALLEL before including this header to enable parallel_for_each_counted(...).
+// This includes <execution>, which might require linking against a parallel backend (e.g. TBB for libstdc++).
+//#define RBFL_ENABLE_PARALLEL
+
+#ifdef RBFL_ENABLE_PARALLEL
+    #include <execution>
+#endif
+
+// Define RBFL_ENABLE_MMAP before including this header to enable MappedFile, a read only memory mapped file for count_records(...).
+// Requires POSIX (<sys/mman.h>).
+//#define RBFL_ENABLE_MMAP
+
+#ifdef RBFL_ENABLE_MMAP
+    #if __has_include(<sys/mman.h>)
+        #include <cerrno>
+        #include <string>
+        #include <system_error>
+        #include <fcntl.h>
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <unistd.h>
+    #else
+        #error "RBFL_ENABLE_MMAP requires POSIX memory mapping (<sys/mman.h>)"
+    #endif
+#endif
+
+// Forces inlining of the functions called for every element, so the loop stays close to a raw loop in unoptimized
+// (debug) builds too. Define RBFL_FORCE_INLINE as empty before including this header to leave it to the compiler.
+#ifndef RBFL_FORCE_INLINE
+    #if defined(__GNUC__) || defined(__clang__)
+        #define RBFL_FORCE_INLINE [[gnu::always_inline]]
+    #elif defined(_MSC_VER)
+        #define RBFL_FORCE_INLINE [[msvc::forceinline]]
+    #else
+        #define RBFL_FORCE_INLINE
+    #endif
+#endif
 
 
 //*******************************************************************************
@@ -54,86 +124,521 @@
 namespace RBFLCounter
 {
 // Counter and offset variable type
-#ifdef RBFL_FORCE_64BIT_COUNTER
-    #ifdef RBFL_ENABLE_SIGNED_COUNTER
+#if RBFL_FORCE_64BIT_COUNTER
+    #if RBFL_ENABLE_SIGNED_COUNTER
         using IndexType = int64_t;
     #else
         using IndexType = uint64_t;
     #endif
 #else
-    #ifdef RBFL_ENABLE_SIGNED_COUNTER
+    #if RBFL_ENABLE_SIGNED_COUNTER
         using IndexType = std::ptrdiff_t;
     #else
         using IndexType = std::size_t;
     #endif
 #endif
 
+//*******************************************************************************
+// Per call index type, e.g. count<std::int16_t>(...). AutoIndex (default) uses the settings above.
+struct AutoIndex {};
+
+template<typename Index>
+concept CounterIndex = std::integral<Index> and not std::is_same_v<Index, bool>;
+
+// Default index type for a range with the given difference type
+template<typename DifferenceType>
+#if RBFL_FORCE_64BIT_COUNTER
+using DefaultIndexType = IndexType;
+#elif RBFL_ENABLE_SIGNED_COUNTER
+using DefaultIndexType = DifferenceType;
+#else
+using DefaultIndexType = std::make_unsigned_t<DifferenceType>;
+#endif
+
+template<typename Index, typename DifferenceType>
+requires std::is_same_v<Index, AutoIndex> or CounterIndex<Index>
+using ResolveIndex = std::conditional_t<std::is_same_v<Index, AutoIndex>, DefaultIndexType<DifferenceType>, Index>;
+
+//*******************************************************************************
+// Instrumentation of count/rcount loops, e.g. for profiling hot loops in release builds.
+// count<Instrumented>(...) records the statistics of the loop and passes them to the sink when the returned range is
+// destroyed (at the end of the Range Based For Loop). The default (NoInstrumentation) adds nothing to the iterators or ranges.
+struct EnumerationStatistics
+{
+    std::size_t iterations = 0;          // Number of increments, less than size if the loop was left early
+    std::size_t size = 0;                // Number of elements, if known in O(1). Otherwise zero
+    std::chrono::nanoseconds duration{}; // Wall time from the first begin() to the destruction of the range
+};
+
+struct NoInstrumentation {};
+
+// Default sink. Forwards the statistics to a callback, which can be set at run time (e.g. to a logger or metrics system).
+// Custom sinks are types with a static Record(const EnumerationStatistics&) function.
+struct CallbackInstrumentationSink
+{
+    static inline void (*Callback)(const EnumerationStatistics&) = nullptr;
+    
+    static void Record(const EnumerationStatistics& statistics)
+    {
+        if(Callback)
+            Callback(statistics);
+    }
+};
+
+// Used in place of the index type: count<Instrumented>(...), count<InstrumentedWith<MySink, std::int32_t>>(...)
+template<typename Sink = CallbackInstrumentationSink, typename Index = AutoIndex>
+requires std::is_same_v<Index, AutoIndex> or CounterIndex<Index>
+struct InstrumentedWith {};
+
+using Instrumented = InstrumentedWith<>;
+
+// Index type and instrumentation policy of the first template parameter of count/rcount
+template<typename Option>
+struct CountOption
+{
+    using Index = Option;
+    using Instrumentation = NoInstrumentation;
+};
+
+template<typename Sink, typename OptionIndexType>
+struct CountOption<InstrumentedWith<Sink, OptionIndexType>>
+{
+    using Index = OptionIndexType;
+    using Instrumentation = InstrumentedWith<Sink, OptionIndexType>;
+};
+
+template<typename Option>
+using OptionIndex = typename CountOption<Option>::Index;
+
+template<typename Option>
+using OptionInstrumentation = typename CountOption<Option>::Instrumentation;
+
+// Statistics of one range. Empty for NoInstrumentation
+template<typename Instrumentation>
+class InstrumentationState
+{
+public:
+    constexpr NoInstrumentation Start(const std::size_t&) const { return {}; }
+};
+
+template<typename Sink, typename Index>
+class InstrumentationState<InstrumentedWith<Sink, Index>>
+{
+private:
+    mutable EnumerationStatistics m_Statistics{};
+    mutable std::chrono::steady_clock::time_point m_Start{};
+    mutable bool m_Started = false;
+    
+public:
+    InstrumentationState() = default;
+    
+    // Copies start without statistics, so only ranges which were iterated report
+    InstrumentationState(const InstrumentationState&) {}
+    InstrumentationState& operator=(const InstrumentationState&) { return *this; }
+    
+    ~InstrumentationState()
+    {
+        if(m_Started)
+        {
+            m_Statistics.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Start);
+            Sink::Record(m_Statistics);
+        }
+    }
+    
+    // Called by begin(), the time is measured from the first call. Returns the statistics the iterators count into
+    EnumerationStatistics* Start(const std::size_t& size) const
+    {
+        if(not m_Started)
+        {
+            m_Started = true;
+            m_Statistics.size = size;
+            m_Start = std::chrono::steady_clock::now();
+        }
+        
+        return &m_Statistics;
+    }
+};
+
+// Number of elements known at compile time (C-style arrays, std::array, std::span with fixed extent). Zero if unknown.
+template<typename ContainerType>
+struct StaticSize : std::integral_constant<std::size_t, 0> {};
+
+template<typename T, std::size_t size>
+struct StaticSize<T[size]> : std::integral_constant<std::size_t, size> {};
+
+template<typename T, std::size_t size>
+struct StaticSize<std::array<T, size>> : std::integral_constant<std::size_t, size> {};
+
+template<typename T, std::size_t size>
+struct StaticSize<std::span<T, size>> : std::integral_constant<std::size_t, (size == std::dynamic_extent) ? 0 : size> {};
+
+// Overflow check at compile time, if the size of the container is known
+template<typename Index, typename ContainerType>
+constexpr void CheckIndexOverflow()
+{
+    constexpr std::size_t size = StaticSize<std::remove_cvref_t<ContainerType>>::value;
+    static_assert(size == 0 or std::cmp_less_equal(size - 1, std::numeric_limits<Index>::max()), "Index type is too small for the number of elements");
+}
+
+//*******************************************************************************
+// Index counting direction.
+// ForwardIndex and ReverseIndex select the direction at compile time, so the increment of the counter
+// is a plain ++/-- without any branch. Passing a bool selects the direction at run time instead.
+struct ForwardIndex_t {};
+struct ReverseIndex_t {};
+
+inline constexpr ForwardIndex_t ForwardIndex{};
+inline constexpr ReverseIndex_t ReverseIndex{};
+
+template<typename Direction>
+concept IndexDirection = std::is_same_v<Direction, ForwardIndex_t> or std::is_same_v<Direction, ReverseIndex_t> or std::is_same_v<Direction, bool>;
+
+// Start value of the counter. The size is only queried if the index has to be reversed.
+// Callers use std::ranges::distance, which is O(1) for sized ranges and sized sentinels, and a single pass otherwise.
+template<CounterIndex Index, IndexDirection Direction, typename SizeFunction>
+constexpr Index StartIndex(const Index& offset, const Direction& direction, SizeFunction&& size)
+{
+    if constexpr (std::is_same_v<Direction, ForwardIndex_t>)
+        return offset;
+    else if constexpr (std::is_same_v<Direction, ReverseIndex_t>)
+        return static_cast<Index>(offset + static_cast<Index>(size()) - 1);
+    else
+        return direction ? static_cast<Index>(offset + static_cast<Index>(size()) - 1) : (offset);
+}
+
+// Iterator concept of IteratorCounter, taken over from the underlying iterator.
+// Contiguous iterators are downgraded to random access, since the dereferenced element/index pair is not an l-value.
+template<typename IteratorType>
+using CounterIteratorConcept = std::conditional_t<std::random_access_iterator<IteratorType>, std::random_access_iterator_tag,
+                               std::conditional_t<std::bidirectional_iterator<IteratorType>, std::bidirectional_iterator_tag,
+                               std::conditional_t<std::forward_iterator<IteratorType>, std::forward_iterator_tag, std::input_iterator_tag>>>;
+
+// Element/index pair returned by dereferencing the counter iterators. Supports structured bindings, get<0>/get<1>
+// and the named accessors value() and index(). The index is stored by value, references to the element as pointer,
+// so the proxy is trivially copyable and stays valid if the iterator is copied or destroyed.
+// Non-reference element types (e.g. std::span for chunks or proxies like std::vector<bool>::reference) are stored by value.
+template<typename ReferenceType, CounterIndex Index>
+class CountedElement
+{
+private:
+    using StorageType = std::conditional_t<std::is_reference_v<ReferenceType>, std::add_pointer_t<std::remove_reference_t<ReferenceType>>, ReferenceType>;
+    
+    StorageType m_Value;
+    Index m_Index;
+    
+public:
+    RBFL_FORCE_INLINE constexpr CountedElement(ReferenceType value, const Index& index) requires std::is_reference_v<ReferenceType>
+        : m_Value(std::addressof(value))
+        , m_Index(index)
+    {}
+    
+    RBFL_FORCE_INLINE constexpr CountedElement(ReferenceType value, const Index& index) requires (not std::is_reference_v<ReferenceType>)
+        : m_Value(std::move(value))
+        , m_Index(index)
+    {}
+    
+    RBFL_FORCE_INLINE constexpr ReferenceType value() const
+    {
+        if constexpr (std::is_reference_v<ReferenceType>)
+            return static_cast<ReferenceType>(*m_Value);
+        else
+            return m_Value;
+    }
+    
+    RBFL_FORCE_INLINE constexpr Index index() const { return m_Index; }
+    
+    template<std::size_t I>
+    requires (I < 2)
+    RBFL_FORCE_INLINE constexpr decltype(auto) get() const
+    {
+        if constexpr (I == 0)
+            return value();
+        else
+            return index();
+    }
+    
+    // Copy of the element and the index, e.g. for the value_type of the iterators
+    template<typename ValueType>
+    requires std::constructible_from<ValueType, ReferenceType>
+    constexpr operator std::pair<ValueType, Index>() const { return {value(), m_Index}; }
+};
+
+template<std::size_t I, typename ReferenceType, CounterIndex Index>
+RBFL_FORCE_INLINE constexpr decltype(auto) get(const CountedElement<ReferenceType, Index>& element) { return element.template get<I>(); }
+
+// Iterator category for pre C++20 algorithms. Move only input iterators don't provide one, use input_iterator_tag for them.
+template<typename IteratorType>
+struct CounterIteratorCategory
+{
+    using type = std::input_iterator_tag;
+};
+
 template<typename IteratorType>
+requires requires { typename std::iterator_traits<IteratorType>::iterator_category; }
+struct CounterIteratorCategory<IteratorType>
+{
+    using type = std::conditional_t<std::random_access_iterator<IteratorType>, std::random_access_iterator_tag, typename std::iterator_traits<IteratorType>::iterator_category>;
+};
+
+template<typename IteratorType, IndexDirection Direction = ForwardIndex_t, CounterIndex Index = IndexType, typename Instrumentation = NoInstrumentation>
 class IteratorCounter
 {
 private:
-    using IteratorReferenceType = typename std::iterator_traits<IteratorType>::reference;
+    using IteratorReferenceType = std::iter_reference_t<IteratorType>;
     
-    IteratorType m_Iterator;
-    IndexType    m_Counter;
-    const bool   m_ReverseIndex;
+    // Runtime direction stores the step (+1 or -1), compile time directions store nothing
+    using StepType = std::conditional_t<std::is_same_v<Direction, bool>, Index, Direction>;
+    
+    // Instrumented iterators count their increments in the statistics of the range
+    using StatisticsType = std::conditional_t<std::is_same_v<Instrumentation, NoInstrumentation>, NoInstrumentation, EnumerationStatistics*>;
+    
+    IteratorType m_Iterator{};
+    Index    m_Counter{};
+    [[no_unique_address]] StepType m_Step{};
+    [[no_unique_address]] StatisticsType m_Statistics{};
+    
+    static constexpr StepType MakeStep(const Direction& direction)
+    {
+        if constexpr (std::is_same_v<Direction, bool>)
+            return direction ? static_cast<Index>(-1) : static_cast<Index>(1);
+        else
+            return direction;
+    }
+    
+    // Counter change when moving the iterator by n elements
+    constexpr Index Steps(const std::iter_difference_t<IteratorType>& n) const
+    {
+        if constexpr (std::is_same_v<Direction, ForwardIndex_t>)
+            return static_cast<Index>(n);
+        else if constexpr (std::is_same_v<Direction, ReverseIndex_t>)
+            return static_cast<Index>(-n);
+        else
+            return static_cast<Index>(static_cast<Index>(n) * m_Step);
+    }
     
 public:
-    IteratorCounter() = delete;
+    using iterator_concept  = CounterIteratorConcept<IteratorType>;
+    using iterator_category = typename CounterIteratorCategory<IteratorType>::type;
+    using difference_type   = std::iter_difference_t<IteratorType>;
+    using value_type        = std::pair<std::iter_value_t<IteratorType>, Index>;
+    using reference         = CountedElement<IteratorReferenceType, Index>;
+    using pointer           = void;
     
-    explicit IteratorCounter(const IteratorType& iterator, const IndexType& offset, const bool& reverseIndex)
-        : m_Iterator(iterator)
+    IteratorCounter() requires std::default_initializable<IteratorType> = default;
+    
+    explicit constexpr IteratorCounter(IteratorType iterator, const Index& offset, const Direction& direction = Direction{})
+        : m_Iterator(std::move(iterator))
         , m_Counter(offset)
-        , m_ReverseIndex(reverseIndex)
+        , m_Step(MakeStep(direction))
     {}
     
-    IteratorCounter& operator++()
+    // Iterator which is already 'distance' elements away from the element with index 'offset'
+    explicit constexpr IteratorCounter(IteratorType iterator, const Index& offset, const Direction& direction, const difference_type& distance)
+        : IteratorCounter(std::move(iterator), offset, direction)
+    {
+        m_Counter += Steps(distance);
+    }
+    
+    RBFL_FORCE_INLINE constexpr IteratorCounter& operator++()
+    {
+        ++m_Iterator;
+        
+        if constexpr (std::is_same_v<Direction, ForwardIndex_t>)
+            ++m_Counter;
+        else if constexpr (std::is_same_v<Direction, ReverseIndex_t>)
+            --m_Counter;
+        else
+            m_Counter += m_Step;
+        
+        if constexpr (not std::is_same_v<Instrumentation, NoInstrumentation>)
+        {
+            if(m_Statistics)
+                m_Statistics->iterations++;
+        }
+        
+        return *this;
+    }
+    
+    constexpr IteratorCounter operator++(int) requires std::copyable<IteratorType>
     {
-        m_Iterator++;
+        IteratorCounter tmp = *this;
+        ++*this;
+        return tmp;
+    }
+    
+    // Single pass, move only iterators can't return a copy
+    constexpr void operator++(int) requires (not std::copyable<IteratorType>) { ++*this; }
+    
+    constexpr IteratorCounter& operator--() requires std::bidirectional_iterator<IteratorType>
+    {
+        --m_Iterator;
         
-        if(m_ReverseIndex)
-            m_Counter--;
+        if constexpr (std::is_same_v<Direction, ForwardIndex_t>)
+            --m_Counter;
+        else if constexpr (std::is_same_v<Direction, ReverseIndex_t>)
+            ++m_Counter;
         else
-            m_Counter++;
+            m_Counter -= m_Step;
         
         return *this;
     }
     
-    std::pair<IteratorReferenceType, const IndexType&> operator*() const { return {*m_Iterator, m_Counter}; }
+    constexpr IteratorCounter operator--(int) requires std::bidirectional_iterator<IteratorType>
+    {
+        IteratorCounter tmp = *this;
+        --*this;
+        return tmp;
+    }
+    
+    // Random access, the counter is updated in O(1)
+    constexpr IteratorCounter& operator+=(const difference_type& n) requires std::random_access_iterator<IteratorType>
+    {
+        m_Iterator += n;
+        m_Counter += Steps(n);
+        return *this;
+    }
+    
+    constexpr IteratorCounter& operator-=(const difference_type& n) requires std::random_access_iterator<IteratorType>
+    {
+        m_Iterator -= n;
+        m_Counter -= Steps(n);
+        return *this;
+    }
+    
+    constexpr IteratorCounter operator+(const difference_type& n) const requires std::random_access_iterator<IteratorType> { IteratorCounter tmp = *this; return tmp += n; }
+    constexpr IteratorCounter operator-(const difference_type& n) const requires std::random_access_iterator<IteratorType> { IteratorCounter tmp = *this; return tmp -= n; }
+    
+    friend constexpr IteratorCounter operator+(const difference_type& n, const IteratorCounter& it) requires std::random_access_iterator<IteratorType> { return it + n; }
+    
+    constexpr difference_type operator-(const IteratorCounter& rhs) const requires std::sized_sentinel_for<IteratorType, IteratorType> { return m_Iterator - rhs.m_Iterator; }
+    
+    constexpr reference operator[](const difference_type& n) const requires std::random_access_iterator<IteratorType> { return *(*this + n); }
+    
+    RBFL_FORCE_INLINE constexpr reference operator*() const { return {*m_Iterator, m_Counter}; }
+    
+    constexpr const IteratorType& base() const { return m_Iterator; }
+    
+    // Index of the element the iterator points to, without dereferencing it
+    RBFL_FORCE_INLINE constexpr Index index() const { return m_Counter; }
+    
+    constexpr void instrument(const StatisticsType& statistics) { m_Statistics = statistics; }
+    
+    RBFL_FORCE_INLINE constexpr bool operator==(const IteratorCounter& rhs) const requires std::equality_comparable<IteratorType> { return m_Iterator == rhs.m_Iterator; }
+    RBFL_FORCE_INLINE constexpr bool operator!=(const IteratorCounter& rhs) const requires std::equality_comparable<IteratorType> { return m_Iterator != rhs.m_Iterator; }
+    
+    constexpr auto operator<=>(const IteratorCounter& rhs) const requires std::random_access_iterator<IteratorType>
+    {
+        if constexpr (std::three_way_comparable<IteratorType>)
+            return m_Iterator <=> rhs.m_Iterator;
+        else
+            return (m_Iterator < rhs.m_Iterator) ? std::weak_ordering::less : ((rhs.m_Iterator < m_Iterator) ? std::weak_ordering::greater : std::weak_ordering::equivalent);
+    }
+};
+
+//*******************************************************************************
+// End marker for ranges where the end is not of the same type as the iterator (e.g. std::views::take, std::views::iota or
+// std::istream_view with std::default_sentinel_t).
+// Only the underlying iterator is compared, the counter doesn't matter for the end.
+template<typename SentinelType>
+class CounterSentinel
+{
+private:
+    SentinelType m_Sentinel{};
+    
+public:
+    CounterSentinel() = default;
+    
+    explicit constexpr CounterSentinel(const SentinelType& sentinel)
+        : m_Sentinel(sentinel)
+    {}
+    
+    constexpr const SentinelType& base() const { return m_Sentinel; }
+    
+    template<typename IteratorType, IndexDirection Direction, CounterIndex Index, typename Instrumentation>
+    requires std::sentinel_for<SentinelType, IteratorType>
+    RBFL_FORCE_INLINE friend constexpr bool operator==(const IteratorCounter<IteratorType, Direction, Index, Instrumentation>& it, const CounterSentinel& sentinel) { return it.base() == sentinel.m_Sentinel; }
     
-    bool operator==(const IteratorCounter& rhs) const { return m_Iterator == rhs.m_Iterator; }
-    bool operator!=(const IteratorCounter& rhs) const { return m_Iterator != rhs.m_Iterator; }
+    template<typename IteratorType, IndexDirection Direction, CounterIndex Index, typename Instrumentation>
+    requires std::sized_sentinel_for<SentinelType, IteratorType>
+    friend constexpr std::iter_difference_t<IteratorType> operator-(const CounterSentinel& sentinel, const IteratorCounter<IteratorType, Direction, Index, Instrumentation>& it) { return sentinel.m_Sentinel - it.base(); }
+    
+    template<typename IteratorType, IndexDirection Direction, CounterIndex Index, typename Instrumentation>
+    requires std::sized_sentinel_for<SentinelType, IteratorType>
+    friend constexpr std::iter_difference_t<IteratorType> operator-(const IteratorCounter<IteratorType, Direction, Index, Instrumentation>& it, const CounterSentinel& sentinel) { return it.base() - sentinel.m_Sentinel; }
+};
+
+//*******************************************************************************
+// Number of elements of a range whose iterators can't compute it in O(1), but the container can (e.g. std::list::size()).
+// Stored by the l-Value range, so its end iterator gets the correct index.
+template<typename DifferenceType>
+struct KnownSize
+{
+    DifferenceType value;
 };
 
+struct UnknownSize {};
+
 //*******************************************************************************
 //                  For l-values, non owning
-template<typename IteratorType>
+// The end can be a sentinel of a different type (e.g. std::unreachable_sentinel_t), see CounterSentinel.
+template<typename IteratorType, IndexDirection Direction = ForwardIndex_t, CounterIndex Index = IndexType, typename SentinelType = IteratorType, typename Instrumentation = NoInstrumentation, typename SizeType = UnknownSize>
 class IteratorCounterRange_lval
 {
-protected:
-    using Iterator = IteratorCounter<IteratorType>;
+private:
+    using Iterator = IteratorCounter<IteratorType, Direction, Index, Instrumentation>;
     
     IteratorType m_First;
-    IteratorType m_Last;
+    SentinelType m_Last;
     
-    const IndexType m_Offset;
-    const bool      m_ReverseIndex;
+    Index m_Offset;
+    [[no_unique_address]] Direction m_Direction;
+    [[no_unique_address]] InstrumentationState<Instrumentation> m_Instrumentation;
+    [[no_unique_address]] SizeType m_Size;
     
-    explicit IteratorCounterRange_lval(const IndexType& offset, const bool& reverseIndex) // Only to be used by derived classes
-        : m_Offset(offset)
-        , m_ReverseIndex(reverseIndex)
-    {}
+    constexpr Iterator Instrument(Iterator iterator) const
+    {
+        if constexpr (not std::is_same_v<Instrumentation, NoInstrumentation>)
+        {
+            if constexpr (std::sized_sentinel_for<SentinelType, IteratorType> and std::copyable<IteratorType>)
+                iterator.instrument(m_Instrumentation.Start(static_cast<std::size_t>(m_Last - m_First)));
+            else if constexpr (not std::is_same_v<SizeType, UnknownSize>)
+                iterator.instrument(m_Instrumentation.Start(static_cast<std::size_t>(m_Size.value)));
+            else
+                iterator.instrument(m_Instrumentation.Start(0));
+        }
+        
+        return iterator;
+    }
     
 public:
-    explicit IteratorCounterRange_lval(IteratorType begin, IteratorType end, const IndexType& offset, const bool& reverseIndex)
-        : m_First(begin)
-        , m_Last(end)
+    explicit constexpr IteratorCounterRange_lval(IteratorType begin, SentinelType end, const Index& offset, const Direction& direction = Direction{}, const Instrumentation& = Instrumentation{}, const SizeType& size = SizeType{})
+        : m_First(std::move(begin))
+        , m_Last(std::move(end))
         , m_Offset(offset)
-        , m_ReverseIndex(reverseIndex)
+        , m_Direction(direction)
+        , m_Size(size)
     {}
     
-    Iterator begin() const { return Iterator(m_First, m_Offset, m_ReverseIndex); }
-    Iterator end()   const { return Iterator(m_Last, m_Offset, m_ReverseIndex); }
+    constexpr const Direction& direction() const { return m_Direction; }
+    
+    constexpr auto size() const requires (not std::is_same_v<SizeType, UnknownSize>) { return static_cast<std::make_unsigned_t<decltype(m_Size.value)>>(m_Size.value); }
+    
+    constexpr Iterator begin() const requires std::copyable<IteratorType> { return Instrument(Iterator(m_First, m_Offset, m_Direction)); }
+    
+    // Single pass, a move only iterator can only be taken once
+    constexpr Iterator begin() requires (not std::copyable<IteratorType>) { return Instrument(Iterator(std::move(m_First), m_Offset, m_Direction)); }
+    
+    constexpr auto end() const
+    {
+        // Give the end iterator its correct index, if that's possible in O(1). Needed for decrementing from the end.
+        // Otherwise (e.g. an iterator pair of a std::list) return a sentinel, so no end iterator with a wrong index can be decremented.
+        if constexpr (std::is_same_v<IteratorType, SentinelType> and std::sized_sentinel_for<IteratorType, IteratorType>)
+            return Iterator(m_Last, m_Offset, m_Direction, m_Last - m_First);
+        else if constexpr (std::is_same_v<IteratorType, SentinelType> and not std::is_same_v<SizeType, UnknownSize>)
+            return Iterator(m_Last, m_Offset, m_Direction, m_Size.value);
+        else
+            return CounterSentinel<SentinelType>(m_Last);
+    }
 };
 
 
@@ -141,171 +646,1341 @@ public:
 //                      For r-values, needs to be owning
 // Concepts
 template<typename ContainerType>
-concept ContainerIsInitializerList = std::is_same_v<ContainerType, std::initializer_list<typename ContainerType::value_type>>;
+concept ContainerIsInitializerList = std::is_same_v<ContainerType, std::initializer_list<std::ranges::range_value_t<ContainerType>>>;
 
 template<typename ContainerType>
 concept ContainerIsNotInitializerList = not ContainerIsInitializerList<ContainerType>;
 
 // Template declaration
-template<typename ContainerType, typename IteratorType, typename ContainerValueType = typename ContainerType::value_type>
+template<typename ContainerType, typename IteratorType, typename ContainerValueType = std::ranges::range_value_t<ContainerType>, IndexDirection Direction = ForwardIndex_t, CounterIndex Index = IndexType, typename Instrumentation = NoInstrumentation>
 class IteratorCounterRange_rval;
 
-// For r-Value containers, which are not std::initializer_list<T>
-template<ContainerIsNotInitializerList ContainerType, typename IteratorType, typename ContainerValueType>
-requires std::is_same_v<ContainerValueType, typename ContainerType::value_type> and (std::is_same_v<IteratorType, typename ContainerType::iterator> or std::is_same_v<IteratorType, typename ContainerType::reverse_iterator>)
-class IteratorCounterRange_rval<ContainerType, IteratorType, ContainerValueType> : public IteratorCounterRange_lval<IteratorType>
+// Reverse iterator of a container, as returned by std::ranges::rbegin
+template<typename ContainerType>
+using ReverseIteratorType = decltype(std::ranges::rbegin(std::declval<ContainerType&>()));
+
+// For r-Value containers, which are not std::initializer_list<T>.
+// The container is moved into the range, no element is copied. Iterators are taken from the owned
+// container on every begin()/end() call, so they stay valid if the range itself gets moved.
+template<ContainerIsNotInitializerList ContainerType, typename IteratorType, typename ContainerValueType, IndexDirection Direction, CounterIndex Index, typename Instrumentation>
+requires std::is_same_v<ContainerValueType, std::ranges::range_value_t<ContainerType>> and (std::is_same_v<IteratorType, std::ranges::iterator_t<ContainerType>> or std::is_same_v<IteratorType, ReverseIteratorType<ContainerType>>)
+class IteratorCounterRange_rval<ContainerType, IteratorType, ContainerValueType, Direction, Index, Instrumentation>
 {
 private:
+    using Iterator = IteratorCounter<IteratorType, Direction, Index, Instrumentation>;
+    
     ContainerType owner;
     
-public:
-    IteratorCounterRange_rval() = delete;
+    Index m_Offset;
+    [[no_unique_address]] Direction m_Direction;
+    [[no_unique_address]] InstrumentationState<Instrumentation> m_Instrumentation;
     
-    explicit IteratorCounterRange_rval(ContainerType&& container, const IndexType& offset, const bool& reverseIndex)
-        : IteratorCounterRange_lval<IteratorType>(offset, reverseIndex)
-        , owner(container)
+    constexpr Iterator Instrument(Iterator iterator) const
     {
-        if constexpr (std::is_same_v<IteratorType, typename ContainerType::iterator>)
+        if constexpr (not std::is_same_v<Instrumentation, NoInstrumentation>)
         {
-            // Forward
-            IteratorCounterRange_lval<IteratorType>::m_First = std::begin(owner);
-            IteratorCounterRange_lval<IteratorType>::m_Last = std::end(owner);
+            if constexpr (std::ranges::sized_range<const ContainerType>)
+                iterator.instrument(m_Instrumentation.Start(static_cast<std::size_t>(std::ranges::size(owner))));
+            else
+                iterator.instrument(m_Instrumentation.Start(0));
         }
-        else if constexpr (std::is_same_v<IteratorType, typename ContainerType::reverse_iterator>)
+        
+        return iterator;
+    }
+    
+public:
+    IteratorCounterRange_rval() = delete;
+    
+    explicit constexpr IteratorCounterRange_rval(ContainerType&& container, const Index& offset, const Direction& direction = Direction{})
+        : owner(std::move(container))
+        , m_Offset(offset)
+        , m_Direction(direction)
+    {}
+    
+    constexpr Iterator begin()
+    {
+        if constexpr (std::is_same_v<IteratorType, std::ranges::iterator_t<ContainerType>>)
+            return Instrument(Iterator(std::ranges::begin(owner), m_Offset, m_Direction)); // Forward
+        else
+            return Instrument(Iterator(std::ranges::rbegin(owner), m_Offset, m_Direction)); // Backward
+    }
+    
+    // Like for l-Values, the end iterator gets its correct index if the size is known in O(1), otherwise a sentinel is returned
+    constexpr auto end()
+    {
+        if constexpr (not std::is_same_v<IteratorType, std::ranges::iterator_t<ContainerType>>)
         {
-            // Backward
-            IteratorCounterRange_lval<IteratorType>::m_First = std::rbegin(owner);
-            IteratorCounterRange_lval<IteratorType>::m_Last = std::rend(owner);
+            if constexpr (std::ranges::sized_range<ContainerType>)
+                return Iterator(std::ranges::rend(owner), m_Offset, m_Direction, std::ranges::distance(owner)); // Backward
+            else
+                return CounterSentinel<IteratorType>(std::ranges::rend(owner)); // Backward
         }
+        else if constexpr (std::ranges::common_range<ContainerType> and std::ranges::sized_range<ContainerType>)
+            return Iterator(std::ranges::end(owner), m_Offset, m_Direction, std::ranges::distance(owner)); // Forward
+        else
+            return CounterSentinel<std::ranges::sentinel_t<ContainerType>>(std::ranges::end(owner)); // Forward, e.g. unbounded std::views::iota
     }
 };
 
-// For r-Value std::initializer_list<T>. This is a special case, since copying std::initializer_list<T> into another one is not advisable because of it's special properties.
+// For r-Value std::initializer_list<T> objects (braced lists like count({1, 2, 3}) don't end up here, see below).
+// This is a special case, since copying std::initializer_list<T> into another one is not advisable because of it's special properties.
 // Use a std::vector<T> and its iterator as the owning type.
-template<ContainerIsInitializerList ContainerType, typename IteratorType, typename ContainerValueType>
-requires std::is_same_v<ContainerValueType, typename ContainerType::value_type> and (std::is_same_v<IteratorType, typename std::vector<ContainerValueType>::iterator> or std::is_same_v<IteratorType, typename std::vector<ContainerValueType>::reverse_iterator>)
-class IteratorCounterRange_rval<ContainerType, IteratorType, ContainerValueType> : public IteratorCounterRange_lval<IteratorType>
+template<ContainerIsInitializerList ContainerType, typename IteratorType, typename ContainerValueType, IndexDirection Direction, CounterIndex Index, typename Instrumentation>
+requires std::is_same_v<ContainerValueType, std::ranges::range_value_t<ContainerType>> and (std::is_same_v<IteratorType, typename std::vector<ContainerValueType>::iterator> or std::is_same_v<IteratorType, typename std::vector<ContainerValueType>::reverse_iterator>)
+class IteratorCounterRange_rval<ContainerType, IteratorType, ContainerValueType, Direction, Index, Instrumentation>
+    : public IteratorCounterRange_rval<std::vector<ContainerValueType>, IteratorType, ContainerValueType, Direction, Index, Instrumentation>
 {
-private:
-    std::vector<ContainerValueType> owner; // std::initializer_list<ContainerValueType> will be copied into this std::vector<ContainerValueType>
-    
 public:
     IteratorCounterRange_rval() = delete;
     
-    explicit IteratorCounterRange_rval(ContainerType&& container, const IndexType& offset, const bool& reverseIndex)
-        : IteratorCounterRange_lval<IteratorType>(offset, reverseIndex)
-        , owner(container)
-    {
-        if constexpr (std::is_same_v<IteratorType, typename std::vector<ContainerValueType>::iterator>)
-        {
-            // Forward
-            IteratorCounterRange_lval<IteratorType>::m_First = std::begin(owner);
-            IteratorCounterRange_lval<IteratorType>::m_Last = std::end(owner);
-        }
-        else if constexpr (std::is_same_v<IteratorType, typename std::vector<ContainerValueType>::reverse_iterator>)
-        {
-            // Backward
-            IteratorCounterRange_lval<IteratorType>::m_First = std::rbegin(owner);
-            IteratorCounterRange_lval<IteratorType>::m_Last = std::rend(owner);
-        }
-    }
+    // std::initializer_list<ContainerValueType> will be copied into a std::vector<ContainerValueType>
+    explicit constexpr IteratorCounterRange_rval(ContainerType&& container, const Index& offset, const Direction& direction = Direction{})
+        : IteratorCounterRange_rval<std::vector<ContainerValueType>, IteratorType, ContainerValueType, Direction, Index, Instrumentation>(std::vector<ContainerValueType>(container), offset, direction)
+    {}
 };
 
+// Type stored by IteratorCounterRange_rval. A std::initializer_list is copied into a std::vector
+template<typename ContainerType>
+using OwnerType = std::conditional_t<ContainerIsInitializerList<ContainerType>, std::vector<std::ranges::range_value_t<ContainerType>>, ContainerType>;
+
+//*******************************************************************************
+// The optional last parameter of all count/rcount overloads selects the index counting direction:
+// ForwardIndex (default), ReverseIndex or a bool for choosing at run time.
+// The optional first template parameter selects the index type, e.g. count<std::int32_t>(container),
+// or enables instrumentation, e.g. count<Instrumented>(container) (see InstrumentedWith).
 //*******************************************************************************
-// Iterator
-template<typename IteratorType> // std::iterator_traits<IteratorType>::difference_type
-constexpr decltype(auto) count(const IteratorType& first, const IteratorType& last, const IndexType& offset = 0, const bool& reverseIndex = false)
+// Iterator and sentinel (the end may be of a different type, e.g. std::default_sentinel_t or std::unreachable_sentinel_t).
+// Move only, single pass input iterators are accepted as r-Values. A reverse index needs the number of elements, so it requires forward iterators.
+template<typename Index = AutoIndex, typename IteratorType, typename SentinelType, IndexDirection Direction = ForwardIndex_t> // std::iterator_traits<IteratorType>::difference_type
+requires std::input_iterator<std::remove_cvref_t<IteratorType>> and std::sentinel_for<std::remove_cvref_t<SentinelType>, std::remove_cvref_t<IteratorType>> and
+         (std::is_same_v<Direction, ForwardIndex_t> or std::forward_iterator<std::remove_cvref_t<IteratorType>>)
+constexpr decltype(auto) count(IteratorType&& first, SentinelType&& last, const ResolveIndex<OptionIndex<Index>, std::iter_difference_t<std::remove_cvref_t<IteratorType>>>& offset = 0, const Direction& direction = Direction{})
 {
-    return IteratorCounterRange_lval(first, last,
-                                     reverseIndex ? (offset + static_cast<IndexType>(std::abs(std::distance(first, last))) - 1) : (offset),
-                                     reverseIndex);
+    // Only called for a reverse index, which is restricted to (copyable) forward iterators
+    const auto start = StartIndex(offset, direction, [&]
+    {
+        if constexpr (std::forward_iterator<std::remove_cvref_t<IteratorType>>)
+            return std::ranges::distance(first, last);
+        else
+            return std::iter_difference_t<std::remove_cvref_t<IteratorType>>{0};
+    });
+    
+    return IteratorCounterRange_lval(std::remove_cvref_t<IteratorType>(std::forward<IteratorType>(first)), std::remove_cvref_t<SentinelType>(std::forward<SentinelType>(last)),
+                                     start,
+                                     direction, OptionInstrumentation<Index>{});
 }
 
 //*******************************************************************************
 // C-style array
-template<typename T, std::size_t size> // std::ptrdiff_t
-constexpr decltype(auto) count(T (&arr)[size], const IndexType& offset = 0, const bool& reverseIndex = false)
+template<typename Index = AutoIndex, typename T, std::size_t size, IndexDirection Direction = ForwardIndex_t> // std::ptrdiff_t
+constexpr decltype(auto) count(T (&arr)[size], const ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>& offset = 0, const Direction& direction = Direction{})
 {
+    CheckIndexOverflow<ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>, T[size]>();
+    
     return IteratorCounterRange_lval(std::begin(std::span<T>(arr)), std::end(std::span<T>(arr)),
-                                     reverseIndex ? (offset + static_cast<IndexType>(size) - 1) : (offset),
-                                     reverseIndex);
+                                     StartIndex(offset, direction, []{ return size; }),
+                                     direction, OptionInstrumentation<Index>{});
 }
 
-template<typename T, std::size_t size> // std::ptrdiff_t
-constexpr decltype(auto) rcount(T (&arr)[size], const IndexType& offset = 0, const bool& reverseIndex = false)
+template<typename Index = AutoIndex, typename T, std::size_t size, IndexDirection Direction = ForwardIndex_t> // std::ptrdiff_t
+constexpr decltype(auto) rcount(T (&arr)[size], const ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>& offset = 0, const Direction& direction = Direction{})
 {
+    CheckIndexOverflow<ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>, T[size]>();
+    
     return IteratorCounterRange_lval(std::rbegin(std::span<T>(arr)), std::rend(std::span<T>(arr)),
-                                     reverseIndex ? (offset + static_cast<IndexType>(size) - 1) : (offset),
-                                     reverseIndex);
+                                     StartIndex(offset, direction, []{ return size; }),
+                                     direction, OptionInstrumentation<Index>{});
 }
 
 //*******************************************************************************
-// l-Value container and l-Value std::initializer_list
-template<typename ContainerType> // std::iterator_traits<typename ContainerType::iterator>::difference_type
-constexpr decltype(auto) count(ContainerType& container, const IndexType& offset = 0, const bool& reverseIndex = false)
+// l-Value container and l-Value std::initializer_list. A reverse index needs the number of elements, so it requires forward ranges.
+template<typename Index = AutoIndex, typename ContainerType, IndexDirection Direction = ForwardIndex_t> // std::iterator_traits<typename ContainerType::iterator>::difference_type
+requires (not std::is_array_v<ContainerType>) and (std::is_same_v<Direction, ForwardIndex_t> or std::ranges::forward_range<ContainerType>)
+constexpr decltype(auto) count(ContainerType& container, const ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>& offset = 0, const Direction& direction = Direction{})
 {
-    return IteratorCounterRange_lval(std::begin(container), std::end(container),
-                                     reverseIndex ? (offset + static_cast<IndexType>(container.size()) - 1) : (offset),
-                                     reverseIndex);
+    CheckIndexOverflow<ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>, ContainerType>();
+    
+    // Containers like std::list or std::map know their size, but their iterators don't
+    if constexpr (std::ranges::sized_range<ContainerType> and not std::sized_sentinel_for<std::ranges::sentinel_t<ContainerType>, std::ranges::iterator_t<ContainerType>>)
+    {
+        const auto size = std::ranges::distance(container);
+        return IteratorCounterRange_lval(std::ranges::begin(container), std::ranges::end(container),
+                                         StartIndex(offset, direction, [&]{ return size; }),
+                                         direction, OptionInstrumentation<Index>{}, KnownSize<std::ranges::range_difference_t<ContainerType>>{size});
+    }
+    else
+        return IteratorCounterRange_lval(std::ranges::begin(container), std::ranges::end(container),
+                                         StartIndex(offset, direction, [&]{ return std::ranges::distance(container); }),
+                                         direction, OptionInstrumentation<Index>{});
 }
 
-template<typename ContainerType> // std::iterator_traits<typename ContainerType::iterator>::difference_type
-constexpr decltype(auto) rcount(ContainerType& container, const IndexType& offset = 0, const bool& reverseIndex = false)
+template<typename Index = AutoIndex, typename ContainerType, IndexDirection Direction = ForwardIndex_t> // std::iterator_traits<typename ContainerType::iterator>::difference_type
+requires (not std::is_array_v<ContainerType>) and (std::is_same_v<Direction, ForwardIndex_t> or std::ranges::forward_range<ContainerType>)
+constexpr decltype(auto) rcount(ContainerType& container, const ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>& offset = 0, const Direction& direction = Direction{})
 {
-    return IteratorCounterRange_lval(std::rbegin(container), std::rend(container),
-                                     reverseIndex ? (offset + static_cast<IndexType>(container.size()) - 1) : (offset),
-                                     reverseIndex);
+    CheckIndexOverflow<ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>, ContainerType>();
+    
+    // Containers like std::list or std::map know their size, but their iterators don't
+    if constexpr (std::ranges::sized_range<ContainerType> and not std::sized_sentinel_for<std::ranges::sentinel_t<ContainerType>, std::ranges::iterator_t<ContainerType>>)
+    {
+        const auto size = std::ranges::distance(container);
+        return IteratorCounterRange_lval(std::ranges::rbegin(container), std::ranges::rend(container),
+                                         StartIndex(offset, direction, [&]{ return size; }),
+                                         direction, OptionInstrumentation<Index>{}, KnownSize<std::ranges::range_difference_t<ContainerType>>{size});
+    }
+    else
+        return IteratorCounterRange_lval(std::ranges::rbegin(container), std::ranges::rend(container),
+                                         StartIndex(offset, direction, [&]{ return std::ranges::distance(container); }),
+                                         direction, OptionInstrumentation<Index>{});
 }
 
 
 //*******************************************************************************
 //-------------------------------------------------------------------------------
 //*******************************************************************************
-// r-Value container
-template<typename ContainerType> // std::iterator_traits<typename ContainerType::iterator>::difference_type
-constexpr decltype(auto) count(ContainerType&& container, const IndexType& offset = 0, const bool& reverseIndex = false)
+// r-Value container. A reverse index requires forward ranges, like for l-Values.
+template<typename Index = AutoIndex, typename ContainerType, IndexDirection Direction = ForwardIndex_t> // std::iterator_traits<typename ContainerType::iterator>::difference_type
+requires (not std::is_lvalue_reference_v<ContainerType>) and (std::is_same_v<Direction, ForwardIndex_t> or std::ranges::forward_range<ContainerType>)
+constexpr decltype(auto) count(ContainerType&& container, const ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>& offset = 0, const Direction& direction = Direction{})
 {
+    using ResolvedIndex = ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>;
+    CheckIndexOverflow<ResolvedIndex, ContainerType>();
+    
     return IteratorCounterRange_rval<ContainerType,
-        typename ContainerType::iterator,
-        typename ContainerType::value_type>(std::move(container),
-                                            reverseIndex ? (offset + static_cast<IndexType>(container.size()) - 1) : (offset),
-                                            reverseIndex);
+        std::ranges::iterator_t<OwnerType<ContainerType>>,
+        std::ranges::range_value_t<ContainerType>,
+        Direction,
+        ResolvedIndex,
+        OptionInstrumentation<Index>>(std::move(container),
+                       StartIndex(offset, direction, [&]{ return std::ranges::distance(container); }),
+                       direction);
 }
 
-template<typename ContainerType> // std::iterator_traits<typename ContainerType::iterator>::difference_type
-constexpr decltype(auto) rcount(ContainerType&& container, const IndexType& offset = 0, const bool& reverseIndex = false)
+template<typename Index = AutoIndex, typename ContainerType, IndexDirection Direction = ForwardIndex_t> // std::iterator_traits<typename ContainerType::iterator>::difference_type
+requires (not std::is_lvalue_reference_v<ContainerType>) and (std::is_same_v<Direction, ForwardIndex_t> or std::ranges::forward_range<ContainerType>)
+constexpr decltype(auto) rcount(ContainerType&& container, const ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>& offset = 0, const Direction& direction = Direction{})
 {
+    using ResolvedIndex = ResolveIndex<OptionIndex<Index>, std::ranges::range_difference_t<ContainerType>>;
+    CheckIndexOverflow<ResolvedIndex, ContainerType>();
+    
     return IteratorCounterRange_rval<ContainerType,
-        typename ContainerType::reverse_iterator,
-        typename ContainerType::value_type>(std::move(container),
-                                            reverseIndex ? (offset + static_cast<IndexType>(container.size()) - 1) : (offset),
-                                            reverseIndex);
+        ReverseIteratorType<OwnerType<ContainerType>>,
+        std::ranges::range_value_t<ContainerType>,
+        Direction,
+        ResolvedIndex,
+        OptionInstrumentation<Index>>(std::move(container),
+                       StartIndex(offset, direction, [&]{ return std::ranges::distance(container); }),
+                       direction);
 }
 
 //*******************************************************************************
-// r-Value std::initializer_list<T> (special case).
-// This is needed, since copying a std::initializer_list is not adviseable.
-// The list will be copied into a std::vector, which then will get iterated.
-template<typename T> // std::ptrdiff_t
-constexpr decltype(auto) count(std::initializer_list<T>&& init_list, const IndexType& offset = 0, const bool& reverseIndex = false)
+// r-Value braced initializer list, e.g. count({1, 2, 3}) (special case).
+// The backing array of a std::initializer_list doesn't live long enough for the loop, so the elements need to be owned.
+// The list is taken as an array r-Value instead, which keeps the number of elements known at compile time.
+// The elements are moved into a std::array, so no heap allocation is needed.
+template<typename Index = AutoIndex, typename T, std::size_t size, IndexDirection Direction = ForwardIndex_t> // std::ptrdiff_t
+constexpr decltype(auto) count(T (&&init_list)[size], const ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>& offset = 0, const Direction& direction = Direction{})
 {
-    return IteratorCounterRange_rval<std::initializer_list<T>,
-        typename std::vector<T>::iterator,
-        T>(std::move(init_list),
-           reverseIndex ? (offset + static_cast<IndexType>(init_list.size()) - 1) : (offset),
-           reverseIndex);
+    using ResolvedIndex = ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>;
+    CheckIndexOverflow<ResolvedIndex, T[size]>();
+    
+    return IteratorCounterRange_rval<std::array<std::remove_cv_t<T>, size>,
+        typename std::array<std::remove_cv_t<T>, size>::iterator,
+        std::remove_cv_t<T>,
+        Direction,
+        ResolvedIndex,
+        OptionInstrumentation<Index>>(std::to_array(std::move(init_list)),
+                       StartIndex(offset, direction, []{ return size; }),
+                       direction);
 }
 
-template<typename T> // std::ptrdiff_t
-constexpr decltype(auto) rcount(std::initializer_list<T>&& init_list, const IndexType& offset = 0, const bool& reverseIndex = false)
+template<typename Index = AutoIndex, typename T, std::size_t size, IndexDirection Direction = ForwardIndex_t> // std::ptrdiff_t
+constexpr decltype(auto) rcount(T (&&init_list)[size], const ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>& offset = 0, const Direction& direction = Direction{})
 {
-    return IteratorCounterRange_rval<std::initializer_list<T>,
-        typename std::vector<T>::reverse_iterator,
-        T>(std::move(init_list),
-           reverseIndex ? (offset + static_cast<IndexType>(init_list.size()) - 1) : (offset),
-           reverseIndex);
+    using ResolvedIndex = ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>;
+    CheckIndexOverflow<ResolvedIndex, T[size]>();
+    
+    return IteratorCounterRange_rval<std::array<std::remove_cv_t<T>, size>,
+        typename std::array<std::remove_cv_t<T>, size>::reverse_iterator,
+        std::remove_cv_t<T>,
+        Direction,
+        ResolvedIndex,
+        OptionInstrumentation<Index>>(std::to_array(std::move(init_list)),
+                       StartIndex(offset, direction, []{ return size; }),
+                       direction);
 }
 
-} // RBFLCounter
+//*******************************************************************************
+//                      Sharding
+// Splits the range of count(...)/rcount(...) into contiguous shards, e.g. for worker threads. Every shard is a range of
+// the same type, which starts with the correct index, so offset and reverse index are kept.
+// The shard sizes differ by at most one element, the first (size % shards) shards are one element larger.
+// Random access ranges are split in O(1). Other ranges are counted once and advanced to the shard.
+
+// Position of the first element of shard 'shardId'
+template<typename DifferenceType>
+constexpr DifferenceType ShardBegin(const DifferenceType& size, const std::size_t& shardId, const std::size_t& shards)
+{
+    const auto shardCount = static_cast<DifferenceType>(shards);
+    const auto id = static_cast<DifferenceType>(shardId);
+    
+    return id * (size / shardCount) + std::min(id, size % shardCount);
+}
+
+// Requires shardId < shards
+template<std::forward_iterator IteratorType, IndexDirection Direction, CounterIndex Index, typename SizeType>
+constexpr decltype(auto) shard(const IteratorCounterRange_lval<IteratorType, Direction, Index, IteratorType, NoInstrumentation, SizeType>& range, const std::size_t& shardId, const std::size_t& shards)
+{
+    auto first = range.begin();
+    const auto size = std::ranges::distance(first.base(), range.end().base());
+    
+    const auto begin = ShardBegin(size, shardId, shards);
+    const auto end = ShardBegin(size, shardId + 1, shards);
+    
+    std::ranges::advance(first, begin);
+    const auto last = std::ranges::next(first.base(), end - begin);
+    
+    if constexpr (std::is_same_v<SizeType, UnknownSize>)
+        return IteratorCounterRange_lval(first.base(), last, first.index(), range.direction());
+    else
+        return IteratorCounterRange_lval(first.base(), last, first.index(), range.direction(), NoInstrumentation{}, SizeType{end - begin});
+}
+
+// All shards in order. Other than calling shard(...) for every shard, this walks non random access ranges only once.
+template<std::forward_iterator IteratorType, IndexDirection Direction, CounterIndex Index, typename SizeType>
+constexpr decltype(auto) partition(const IteratorCounterRange_lval<IteratorType, Direction, Index, IteratorType, NoInstrumentation, SizeType>& range, const std::size_t& shards)
+{
+    std::vector<IteratorCounterRange_lval<IteratorType, Direction, Index, IteratorType, NoInstrumentation, SizeType>> result;
+    result.reserve(shards);
+    
+    auto first = range.begin();
+    const auto size = std::ranges::distance(first.base(), range.end().base());
+    
+    for(std::size_t shardId = 0; shardId < shards; shardId++)
+    {
+        const auto shardSize = ShardBegin(size, shardId + 1, shards) - ShardBegin(size, shardId, shards);
+        auto last = std::ranges::next(first, shardSize);
+        
+        if constexpr (std::is_same_v<SizeType, UnknownSize>)
+            result.emplace_back(first.base(), last.base(), first.index(), range.direction());
+        else
+            result.emplace_back(first.base(), last.base(), first.index(), range.direction(), NoInstrumentation{}, SizeType{shardSize});
+        first = last;
+    }
+    
+    return result;
+}
+
+//*******************************************************************************
+//                      Filtered enumeration
+// count_if(container, predicate, offset) only visits the elements for which predicate(element) is true.
+// The index is the index of the element in the whole container, like for count(...).
+// For random access ranges of arithmetic types, blocks without a match are skipped with a branchless scan.
+// The predicate may be called more than once per element, so it must not have side effects.
+template<typename IteratorType, typename Predicate, IndexDirection Direction = ForwardIndex_t, CounterIndex Index = IndexType>
+class FilterIteratorCounter
+{
+private:
+    using Counter = IteratorCounter<IteratorType, Direction, Index>;
+    
+    static constexpr std::iter_difference_t<IteratorType> BlockSize = 16;
+    
+    Counter m_Current{};
+    IteratorType m_End{};
+    const Predicate* m_Predicate{};
+    
+    constexpr bool Matches(const IteratorType& it) const { return static_cast<bool>(std::invoke(*m_Predicate, *it)); }
+    
+    // Moves to the next matching element or the end
+    constexpr void SkipNonMatching()
+    {
+        if constexpr (std::random_access_iterator<IteratorType> and std::is_arithmetic_v<std::iter_value_t<IteratorType>>)
+        {
+            const IteratorType first = m_Current.base();
+            IteratorType it = first;
+            
+            while(m_End - it >= BlockSize)
+            {
+                bool anyMatch = false;
+                
+                for(std::iter_difference_t<IteratorType> i = 0; i < BlockSize; i++)
+                    anyMatch |= static_cast<bool>(std::invoke(*m_Predicate, it[i]));
+                
+                if(anyMatch)
+                    break;
+                
+                it += BlockSize;
+            }
+            
+            while(it != m_End and not Matches(it))
+                ++it;
+            
+            m_Current += it - first;
+        }
+        else
+        {
+            while(m_Current.base() != m_End and not Matches(m_Current.base()))
+                ++m_Current;
+        }
+    }
+    
+public:
+    using iterator_concept  = std::conditional_t<std::forward_iterator<IteratorType>, std::forward_iterator_tag, std::input_iterator_tag>;
+    using iterator_category = iterator_concept;
+    using difference_type   = typename Counter::difference_type;
+    using value_type        = typename Counter::value_type;
+    using reference         = typename Counter::reference;
+    using pointer           = void;
+    
+    FilterIteratorCounter() = default;
+    
+    explicit constexpr FilterIteratorCounter(const Counter& current, const IteratorType& end, const Predicate* predicate)
+        : m_Current(current)
+        , m_End(end)
+        , m_Predicate(predicate)
+    {
+        SkipNonMatching();
+    }
+    
+    constexpr reference operator*() const { return *m_Current; }
+    
+    constexpr FilterIteratorCounter& operator++()
+    {
+        ++m_Current;
+        SkipNonMatching();
+        return *this;
+    }
+    
+    constexpr FilterIteratorCounter operator++(int)
+    {
+        FilterIteratorCounter tmp = *this;
+        ++*this;
+        return tmp;
+    }
+    
+    constexpr const IteratorType& base() const { return m_Current.base(); }
+    constexpr Index index() const { return m_Current.index(); }
+    
+    constexpr bool operator==(const FilterIteratorCounter& rhs) const { return m_Current == rhs.m_Current; }
+};
+
+// Non owning, the container must outlive the loop. The iterators refer to the predicate stored in the range.
+template<typename IteratorType, typename Predicate, IndexDirection Direction = ForwardIndex_t, CounterIndex Index = IndexType>
+class IteratorCounterRange_filter
+{
+private:
+    using Counter = IteratorCounter<IteratorType, Direction, Index>;
+    using Iterator = FilterIteratorCounter<IteratorType, Predicate, Direction, Index>;
+    
+    IteratorType m_First;
+    IteratorType m_Last;
+    Predicate m_Predicate;
+    
+    Index m_Offset;
+    [[no_unique_address]] Direction m_Direction;
+    
+public:
+    explicit constexpr IteratorCounterRange_filter(IteratorType begin, IteratorType end, Predicate predicate, const Index& offset, const Direction& direction = Direction{})
+        : m_First(std::move(begin))
+        , m_Last(std::move(end))
+        , m_Predicate(std::move(predicate))
+        , m_Offset(offset)
+        , m_Direction(direction)
+    {}
+    
+    constexpr Iterator begin() const { return Iterator(Counter(m_First, m_Offset, m_Direction), m_Last, &m_Predicate); }
+    constexpr Iterator end()   const { return Iterator(Counter(m_Last, m_Offset, m_Direction), m_Last, &m_Predicate); }
+};
+
+template<typename Index = AutoIndex, typename ContainerType, typename Predicate, IndexDirection Direction = ForwardIndex_t>
+requires std::ranges::forward_range<ContainerType> and std::ranges::common_range<ContainerType> and std::indirect_unary_predicate<const Predicate, std::ranges::iterator_t<ContainerType>>
+constexpr decltype(auto) count_if(ContainerType& container, Predicate predicate, const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset = 0, const Direction& direction = Direction{})
+{
+    CheckIndexOverflow<ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>, ContainerType>();
+    
+    return IteratorCounterRange_filter(std::ranges::begin(container), std::ranges::end(container), std::move(predicate),
+                                       StartIndex(offset, direction, [&]{ return std::ranges::distance(container); }),
+                                       direction);
+}
+
+template<typename Index = AutoIndex, typename ContainerType, typename Predicate, IndexDirection Direction = ForwardIndex_t>
+requires std::ranges::bidirectional_range<ContainerType> and std::ranges::common_range<ContainerType> and std::indirect_unary_predicate<const Predicate, std::ranges::iterator_t<ContainerType>>
+constexpr decltype(auto) rcount_if(ContainerType& container, Predicate predicate, const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset = 0, const Direction& direction = Direction{})
+{
+    CheckIndexOverflow<ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>, ContainerType>();
+    
+    return IteratorCounterRange_filter(std::ranges::rbegin(container), std::ranges::rend(container), std::move(predicate),
+                                       StartIndex(offset, direction, [&]{ return std::ranges::distance(container); }),
+                                       direction);
+}
+
+//*******************************************************************************
+//                      Chunked enumeration of contiguous ranges
+// Yields blocks of up to chunkSize elements as (std::span<T>, baseIndex), where baseIndex is the index of span[0].
+// Forward (count_chunks): Blocks start at the front, the last block may be smaller. span[j] has the index baseIndex + j.
+// Reverse (rcount_chunks): Blocks start at the back, the last block (front of the container) may be smaller.
+//                          Indices are counted like rcount(...), so span[j] has the index baseIndex - j.
+template<typename T, bool ReverseElements, CounterIndex Index = IndexType>
+class ChunkCounter
+{
+private:
+    std::span<T> m_Data{};
+    std::size_t  m_ChunkSize{1};
+    std::size_t  m_Chunk{}; // Number of the current chunk
+    Index    m_Offset{};
+    
+    // Only called for chunks within the data, so m_Chunk * m_ChunkSize is smaller than the size and can't overflow.
+    // The other end is clamped to the data without multiplying past its size.
+    constexpr std::size_t ChunkBegin() const
+    {
+        if constexpr (ReverseElements)
+        {
+            const std::size_t end = ChunkEnd();
+            return end - std::min(m_ChunkSize, end);
+        }
+        else
+            return m_Chunk * m_ChunkSize;
+    }
+    
+    constexpr std::size_t ChunkEnd() const
+    {
+        if constexpr (ReverseElements)
+            return m_Data.size() - m_Chunk * m_ChunkSize;
+        else
+        {
+            const std::size_t begin = ChunkBegin();
+            return begin + std::min(m_ChunkSize, m_Data.size() - begin);
+        }
+    }
+    
+public:
+    using iterator_concept  = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type   = std::ptrdiff_t;
+    using value_type        = std::pair<std::span<T>, Index>;
+    using reference         = CountedElement<std::span<T>, Index>;
+    using pointer           = void;
+    
+    ChunkCounter() = default;
+    
+    explicit constexpr ChunkCounter(const std::span<T>& data, const std::size_t& chunkSize, const std::size_t& chunk, const Index& offset)
+        : m_Data(data)
+        , m_ChunkSize(chunkSize)
+        , m_Chunk(chunk)
+        , m_Offset(offset)
+    {}
+    
+    constexpr reference operator*() const
+    {
+        const std::size_t first = ChunkBegin();
+        
+        if constexpr (ReverseElements)
+            return {m_Data.subspan(first, ChunkEnd() - first), static_cast<Index>(m_Offset + static_cast<Index>(m_Data.size() - 1 - first))};
+        else
+            return {m_Data.subspan(first, ChunkEnd() - first), static_cast<Index>(m_Offset + static_cast<Index>(first))};
+    }
+    
+    constexpr reference operator[](const difference_type& n) const { return *(*this + n); }
+    
+    constexpr ChunkCounter& operator++() { ++m_Chunk; return *this; }
+    constexpr ChunkCounter& operator--() { --m_Chunk; return *this; }
+    constexpr ChunkCounter  operator++(int) { ChunkCounter tmp = *this; ++m_Chunk; return tmp; }
+    constexpr ChunkCounter  operator--(int) { ChunkCounter tmp = *this; --m_Chunk; return tmp; }
+    
+    constexpr ChunkCounter& operator+=(const difference_type& n) { m_Chunk += static_cast<std::size_t>(n); return *this; }
+    constexpr ChunkCounter& operator-=(const difference_type& n) { m_Chunk -= static_cast<std::size_t>(n); return *this; }
+    
+    constexpr ChunkCounter operator+(const difference_type& n) const { ChunkCounter tmp = *this; return tmp += n; }
+    constexpr ChunkCounter operator-(const difference_type& n) const { ChunkCounter tmp = *this; return tmp -= n; }
+    
+    friend constexpr ChunkCounter operator+(const difference_type& n, const ChunkCounter& it) { return it + n; }
+    
+    constexpr difference_type operator-(const ChunkCounter& rhs) const { return static_cast<difference_type>(m_Chunk) - static_cast<difference_type>(rhs.m_Chunk); }
+    
+    constexpr bool operator==(const ChunkCounter& rhs) const { return m_Chunk == rhs.m_Chunk; }
+    constexpr auto operator<=>(const ChunkCounter& rhs) const { return m_Chunk <=> rhs.m_Chunk; }
+};
+
+// Non owning, the container must outlive the range. Throws std::invalid_argument if chunkSize is zero.
+template<typename T, bool ReverseElements, CounterIndex Index = IndexType>
+class ChunkCounterRange : public std::ranges::view_interface<ChunkCounterRange<T, ReverseElements, Index>>
+{
+private:
+    using Iterator = ChunkCounter<T, ReverseElements, Index>;
+    
+    std::span<T> m_Data{};
+    std::size_t  m_ChunkSize{1};
+    Index    m_Offset{};
+    
+public:
+    ChunkCounterRange() = default;
+    
+    explicit constexpr ChunkCounterRange(const std::span<T>& data, const std::size_t& chunkSize, const Index& offset)
+        : m_Data(data)
+        , m_ChunkSize(chunkSize)
+        , m_Offset(offset)
+    {
+        if(chunkSize == 0)
+            throw std::invalid_argument("Chunk size must be greater than zero");
+    }
+    
+    constexpr std::size_t size() const { return m_Data.size() / m_ChunkSize + (m_Data.size() % m_ChunkSize != 0); }
+    
+    constexpr Iterator begin() const { return Iterator(m_Data, m_ChunkSize, 0, m_Offset); }
+    constexpr Iterator end()   const { return Iterator(m_Data, m_ChunkSize, size(), m_Offset); }
+};
+
+// Any contiguous container or C-style array, which outlives the loop (l-Values and std::span)
+template<typename Index = AutoIndex, std::ranges::contiguous_range ContainerType>
+requires std::ranges::sized_range<ContainerType> and std::ranges::borrowed_range<ContainerType>
+constexpr decltype(auto) count_chunks(ContainerType&& container, const std::size_t& chunkSize, const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset = 0)
+{
+    using T = std::remove_reference_t<std::ranges::range_reference_t<ContainerType>>;
+    CheckIndexOverflow<ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>, ContainerType>();
+    
+    return ChunkCounterRange<T, false, ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>>(std::span<T>(std::ranges::data(container), std::ranges::size(container)), chunkSize, offset);
+}
+
+template<typename Index = AutoIndex, std::ranges::contiguous_range ContainerType>
+requires std::ranges::sized_range<ContainerType> and std::ranges::borrowed_range<ContainerType>
+constexpr decltype(auto) rcount_chunks(ContainerType&& container, const std::size_t& chunkSize, const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset = 0)
+{
+    using T = std::remove_reference_t<std::ranges::range_reference_t<ContainerType>>;
+    CheckIndexOverflow<ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>, ContainerType>();
+    
+    return ChunkCounterRange<T, true, ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>>(std::span<T>(std::ranges::data(container), std::ranges::size(container)), chunkSize, offset);
+}
+
+//*******************************************************************************
+//                      Fixed size records in raw byte buffers
+// count_records<Record>(bytes) reinterprets a byte buffer (e.g. a memory mapped file) as an array of records in place,
+// without copying. It yields (const Record&, index) like count(...) and takes the same offset and direction parameters.
+// Throws std::invalid_argument if the buffer is not aligned for Record or its size is not a multiple of sizeof(Record).
+template<typename Record>
+requires std::is_trivially_copyable_v<Record>
+std::span<const Record> RecordSpan(const std::span<const std::byte>& bytes)
+{
+    if(reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(Record) != 0)
+        throw std::invalid_argument("Byte buffer is not aligned for the record type");
+    
+    if(bytes.size() % sizeof(Record) != 0)
+        throw std::invalid_argument("Byte buffer size is not a multiple of the record size");
+    
+    return std::span<const Record>(reinterpret_cast<const Record*>(bytes.data()), bytes.size() / sizeof(Record));
+}
+
+template<typename Record, typename Index = AutoIndex, IndexDirection Direction = ForwardIndex_t> // std::ptrdiff_t
+requires std::is_trivially_copyable_v<Record>
+decltype(auto) count_records(const std::span<const std::byte>& bytes, const ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>& offset = 0, const Direction& direction = Direction{})
+{
+    const std::span<const Record> records = RecordSpan<Record>(bytes);
+    
+    return IteratorCounterRange_lval(records.begin(), records.end(),
+                                     StartIndex(offset, direction, [&]{ return records.size(); }),
+                                     direction, OptionInstrumentation<Index>{});
+}
+
+template<typename Record, typename Index = AutoIndex, IndexDirection Direction = ForwardIndex_t> // std::ptrdiff_t
+requires std::is_trivially_copyable_v<Record>
+decltype(auto) rcount_records(const std::span<const std::byte>& bytes, const ResolveIndex<OptionIndex<Index>, std::ptrdiff_t>& offset = 0, const Direction& direction = Direction{})
+{
+    const std::span<const Record> records = RecordSpan<Record>(bytes);
+    
+    return IteratorCounterRange_lval(records.rbegin(), records.rend(),
+                                     StartIndex(offset, direction, [&]{ return records.size(); }),
+                                     direction, OptionInstrumentation<Index>{});
+}
+
+#ifdef RBFL_ENABLE_MMAP
+// Read only memory mapping of a whole file, unmapped on destruction. Throws std::system_error if the file can't be mapped.
+// Usage: MappedFile file("records.bin"); for(auto [record, index] : count_records<Record>(file.bytes())) ...
+class MappedFile
+{
+private:
+    const std::byte* m_Data = nullptr;
+    std::size_t m_Size = 0;
+    
+    void Unmap()
+    {
+        if(m_Data)
+            ::munmap(const_cast<std::byte*>(m_Data), m_Size);
+        
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+    
+public:
+    explicit MappedFile(const std::string& path)
+    {
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if(file < 0)
+            throw std::system_error(errno, std::generic_category(), "Can't open " + path);
+        
+        struct stat status{};
+        if(::fstat(file, &status) != 0)
+        {
+            const int error = errno;
+            ::close(file);
+            throw std::system_error(error, std::generic_category(), "Can't get the size of " + path);
+        }
+        
+        m_Size = static_cast<std::size_t>(status.st_size);
+        
+        // Empty files can't be mapped
+        if(m_Size > 0)
+        {
+            void* data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+            if(data == MAP_FAILED)
+            {
+                const int error = errno;
+                ::close(file);
+                throw std::system_error(error, std::generic_category(), "Can't map " + path);
+            }
+            
+            m_Data = static_cast<const std::byte*>(data);
+        }
+        
+        // The mapping stays valid after closing the file
+        ::close(file);
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    MappedFile(MappedFile&& other) noexcept
+        : m_Data(std::exchange(other.m_Data, nullptr))
+        , m_Size(std::exchange(other.m_Size, 0))
+    {}
+    
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if(this != &other)
+        {
+            Unmap();
+            m_Data = std::exchange(other.m_Data, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+        }
+        
+        return *this;
+    }
+    
+    ~MappedFile() { Unmap(); }
+    
+    const std::byte* data() const { return m_Data; }
+    std::size_t size() const { return m_Size; }
+    
+    std::span<const std::byte> bytes() const { return {m_Data, m_Size}; }
+};
+#endif // RBFL_ENABLE_MMAP
+
+//*******************************************************************************
+//                      Multiple ranges in lockstep (zip)
+// count(a, b, c, offset) advances the iterators of all ranges together and yields (a_ref, b_ref, c_ref, index).
+// Iteration stops at the end of the shortest range.
+template<CounterIndex Index, typename... IteratorTypes>
+class ZipIteratorCounter
+{
+private:
+    std::tuple<IteratorTypes...> m_Iterators{};
+    Index m_Counter{};
+    
+public:
+    using iterator_concept  = std::conditional_t<(std::forward_iterator<IteratorTypes> and ...), std::forward_iterator_tag, std::input_iterator_tag>;
+    using iterator_category = iterator_concept;
+    using difference_type   = std::common_type_t<std::iter_difference_t<IteratorTypes>...>;
+    using value_type        = std::tuple<std::iter_value_t<IteratorTypes>..., Index>;
+    using reference         = std::tuple<std::iter_reference_t<IteratorTypes>..., Index>;
+    using pointer           = void;
+    
+    ZipIteratorCounter() = default;
+    
+    explicit constexpr ZipIteratorCounter(const std::tuple<IteratorTypes...>& iterators, const Index& offset)
+        : m_Iterators(iterators)
+        , m_Counter(offset)
+    {}
+    
+    constexpr reference operator*() const
+    {
+        return std::apply([this](const auto&... iterators) { return reference(*iterators..., m_Counter); }, m_Iterators);
+    }
+    
+    constexpr ZipIteratorCounter& operator++()
+    {
+        std::apply([](auto&... iterators) { (++iterators, ...); }, m_Iterators);
+        ++m_Counter;
+        
+        return *this;
+    }
+    
+    constexpr ZipIteratorCounter operator++(int)
+    {
+        ZipIteratorCounter tmp = *this;
+        ++*this;
+        return tmp;
+    }
+    
+    constexpr const std::tuple<IteratorTypes...>& base() const { return m_Iterators; }
+    
+    // All iterators move in lockstep, so comparing the first one is enough
+    constexpr bool operator==(const ZipIteratorCounter& rhs) const { return std::get<0>(m_Iterators) == std::get<0>(rhs.m_Iterators); }
+};
+
+template<typename... SentinelTypes>
+class ZipCounterSentinel
+{
+private:
+    std::tuple<SentinelTypes...> m_Sentinels{};
+    
+public:
+    ZipCounterSentinel() = default;
+    
+    explicit constexpr ZipCounterSentinel(const std::tuple<SentinelTypes...>& sentinels)
+        : m_Sentinels(sentinels)
+    {}
+    
+    // Stop at the shortest range: The end is reached as soon as one of the iterators reaches the end of its range
+    template<CounterIndex Index, typename... IteratorTypes>
+    requires (sizeof...(IteratorTypes) == sizeof...(SentinelTypes))
+    friend constexpr bool operator==(const ZipIteratorCounter<Index, IteratorTypes...>& it, const ZipCounterSentinel& sentinel)
+    {
+        return [&]<std::size_t... I>(std::index_sequence<I...>) { return ((std::get<I>(it.base()) == std::get<I>(sentinel.m_Sentinels)) or ...); }(std::index_sequence_for<SentinelTypes...>{});
+    }
+};
+
+// Non owning, all ranges must outlive the loop
+template<typename IteratorType, typename SentinelType>
+class IteratorCounterRange_zip
+{
+private:
+    IteratorType m_First;
+    SentinelType m_Last;
+    
+public:
+    explicit constexpr IteratorCounterRange_zip(const IteratorType& begin, const SentinelType& end)
+        : m_First(begin)
+        , m_Last(end)
+    {}
+    
+    constexpr IteratorType begin() const { return m_First; }
+    constexpr SentinelType end()   const { return m_Last; }
+};
+
+// Number of ranges in the arguments of count(a, b, c, offset). Zero if the arguments are no valid zip arguments.
+// Ranges must be borrowed (l-Values), so they outlive the loop. rcount additionally needs sized bidirectional ranges.
+template<bool ReverseElements, typename... Args>
+constexpr std::size_t ZipRangeCount()
+{
+    using Arguments = std::tuple<Args...>;
+    constexpr bool hasOffset = std::integral<std::remove_cvref_t<std::tuple_element_t<sizeof...(Args) - 1, Arguments>>>;
+    constexpr std::size_t ranges = hasOffset ? (sizeof...(Args) - 1) : sizeof...(Args);
+    
+    constexpr bool valid = []<std::size_t... I>(std::index_sequence<I...>)
+    {
+        if constexpr (ReverseElements)
+            return ((std::ranges::bidirectional_range<std::tuple_element_t<I, Arguments>> and std::ranges::common_range<std::tuple_element_t<I, Arguments>> and
+                     std::ranges::sized_range<std::tuple_element_t<I, Arguments>> and std::ranges::borrowed_range<std::tuple_element_t<I, Arguments>>) and ...);
+        else
+            return ((std::ranges::input_range<std::tuple_element_t<I, Arguments>> and std::ranges::borrowed_range<std::tuple_element_t<I, Arguments>>) and ...);
+    }(std::make_index_sequence<ranges>{});
+    
+    return valid ? ranges : 0;
+}
+
+template<bool ReverseElements, typename... Args>
+concept ZipArguments = (sizeof...(Args) >= 2) and (ZipRangeCount<ReverseElements, Args...>() >= 2);
+
+template<typename Index, bool ReverseElements, typename ArgumentsTuple, std::size_t... I>
+constexpr decltype(auto) MakeZipRange(ArgumentsTuple&& arguments, std::index_sequence<I...>)
+{
+    using ResolvedIndex = ResolveIndex<Index, std::common_type_t<std::ranges::range_difference_t<std::tuple_element_t<I, std::remove_cvref_t<ArgumentsTuple>>>...>>;
+    (CheckIndexOverflow<ResolvedIndex, std::tuple_element_t<I, std::remove_cvref_t<ArgumentsTuple>>>(), ...);
+    
+    ResolvedIndex offset = 0;
+    if constexpr (sizeof...(I) < std::tuple_size_v<std::remove_cvref_t<ArgumentsTuple>>)
+        offset = static_cast<ResolvedIndex>(std::get<sizeof...(I)>(arguments));
+    
+    if constexpr (ReverseElements)
+    {
+        // Align all ranges at the length of the shortest one, so the last elements of all ranges belong together
+        const auto size = std::min({static_cast<std::ptrdiff_t>(std::ranges::distance(std::get<I>(arguments)))...});
+        
+        using Iterator = ZipIteratorCounter<ResolvedIndex, std::reverse_iterator<std::ranges::iterator_t<std::tuple_element_t<I, std::remove_cvref_t<ArgumentsTuple>>>>...>;
+        using Sentinel = ZipCounterSentinel<std::reverse_iterator<std::ranges::iterator_t<std::tuple_element_t<I, std::remove_cvref_t<ArgumentsTuple>>>>...>;
+        
+        return IteratorCounterRange_zip(Iterator(std::tuple(std::make_reverse_iterator(std::ranges::next(std::ranges::begin(std::get<I>(arguments)), size))...), offset),
+                                        Sentinel(std::tuple(std::make_reverse_iterator(std::ranges::begin(std::get<I>(arguments)))...)));
+    }
+    else
+    {
+        using Iterator = ZipIteratorCounter<ResolvedIndex, std::ranges::iterator_t<std::tuple_element_t<I, std::remove_cvref_t<ArgumentsTuple>>>...>;
+        using Sentinel = ZipCounterSentinel<std::ranges::sentinel_t<std::tuple_element_t<I, std::remove_cvref_t<ArgumentsTuple>>>...>;
+        
+        return IteratorCounterRange_zip(Iterator(std::tuple(std::ranges::begin(std::get<I>(arguments))...), offset),
+                                        Sentinel(std::tuple(std::ranges::end(std::get<I>(arguments))...)));
+    }
+}
+
+// Usage: count(positions, velocities, masses) or count(positions, velocities, masses, offset)
+template<typename Index = AutoIndex, typename... Args>
+requires ZipArguments<false, Args...>
+constexpr decltype(auto) count(Args&&... args)
+{
+    return MakeZipRange<Index, false>(std::forward_as_tuple(args...), std::make_index_sequence<ZipRangeCount<false, Args...>()>{});
+}
+
+// Starts with the last elements. Ranges of different length are aligned at the length of the shortest range.
+template<typename Index = AutoIndex, typename... Args>
+requires ZipArguments<true, Args...>
+constexpr decltype(auto) rcount(Args&&... args)
+{
+    return MakeZipRange<Index, true>(std::forward_as_tuple(args...), std::make_index_sequence<ZipRangeCount<true, Args...>()>{});
+}
+
+//*******************************************************************************
+//                      Strided enumeration and sub-ranges
+// count_strided(container, start, stop, step) visits the elements at start, start + step, ... (< stop).
+// The index is the position of the element in the whole container (plus offset), not a local counter.
+// Skipped elements are never dereferenced. rcount_strided visits the same elements starting with the last one.
+template<typename IteratorType, CounterIndex Index = IndexType>
+class StridedIteratorCounter
+{
+public:
+    using difference_type = std::iter_difference_t<IteratorType>;
+    
+private:
+    IteratorType    m_Iterator{};
+    difference_type m_Step{1};     // Negative for rcount_strided
+    difference_type m_Remaining{}; // Number of elements left to visit, zero for the end
+    Index           m_Counter{};
+    
+public:
+    using iterator_concept  = std::conditional_t<std::forward_iterator<IteratorType>, std::forward_iterator_tag, std::input_iterator_tag>;
+    using iterator_category = iterator_concept;
+    using value_type        = std::pair<std::iter_value_t<IteratorType>, Index>;
+    using reference         = CountedElement<std::iter_reference_t<IteratorType>, Index>;
+    using pointer           = void;
+    
+    StridedIteratorCounter() = default;
+    
+    // 'position' is the position of 'iterator' in the container, 'elements' the number of elements to visit from there
+    explicit constexpr StridedIteratorCounter(const IteratorType& iterator, const difference_type& position, const difference_type& step, const difference_type& elements, const Index& offset)
+        : m_Iterator(iterator)
+        , m_Step(step)
+        , m_Remaining(elements)
+        , m_Counter(static_cast<Index>(offset + static_cast<Index>(position)))
+    {}
+    
+    constexpr reference operator*() const { return {*m_Iterator, m_Counter}; }
+    
+    constexpr StridedIteratorCounter& operator++()
+    {
+        // Neither the underlying iterator nor the counter move beyond the last element, so a large step can't overflow
+        if(--m_Remaining != 0)
+        {
+            std::ranges::advance(m_Iterator, m_Step);
+            m_Counter += static_cast<Index>(m_Step);
+        }
+        
+        return *this;
+    }
+    
+    constexpr StridedIteratorCounter operator++(int)
+    {
+        StridedIteratorCounter tmp = *this;
+        ++*this;
+        return tmp;
+    }
+    
+    constexpr bool operator==(const StridedIteratorCounter& rhs) const { return m_Remaining == rhs.m_Remaining; }
+};
+
+// Non owning, the container must outlive the loop
+template<typename IteratorType, CounterIndex Index = IndexType>
+class IteratorCounterRange_strided
+{
+private:
+    using Iterator = StridedIteratorCounter<IteratorType, Index>;
+    
+    Iterator m_First;
+    Iterator m_Last;
+    
+public:
+    explicit constexpr IteratorCounterRange_strided(const Iterator& begin, const Iterator& end)
+        : m_First(begin)
+        , m_Last(end)
+    {}
+    
+    constexpr Iterator begin() const { return m_First; }
+    constexpr Iterator end()   const { return m_Last; }
+};
+
+template<typename DifferenceType>
+constexpr void CheckStride(const DifferenceType& start, const DifferenceType& step)
+{
+    if(start < 0)
+        throw std::invalid_argument("Start of a strided range must not be negative");
+    
+    if(step <= 0)
+        throw std::invalid_argument("Step of a strided range must be greater than zero");
+}
+
+// Number of elements at start, start + step, ... (< last). Doesn't overflow for large steps
+template<typename DifferenceType>
+constexpr DifferenceType StridedElements(const DifferenceType& start, const DifferenceType& last, const DifferenceType& step)
+{
+    return (last > start) ? ((last - start - 1) / step + 1) : 0;
+}
+
+// Throws std::invalid_argument if start is negative or step is not positive. A stop beyond the end of the container is clamped to its size.
+// The size is taken in O(1) for sized ranges, otherwise it's counted once.
+template<typename Index = AutoIndex, typename ContainerType>
+requires std::ranges::forward_range<ContainerType> and std::ranges::borrowed_range<ContainerType>
+constexpr decltype(auto) count_strided(ContainerType&& container,
+                                       const std::ranges::range_difference_t<ContainerType>& start,
+                                       const std::ranges::range_difference_t<ContainerType>& stop,
+                                       const std::ranges::range_difference_t<ContainerType>& step = 1,
+                                       const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset = 0)
+{
+    using ResolvedIndex = ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>;
+    using Iterator = StridedIteratorCounter<std::ranges::iterator_t<ContainerType>, ResolvedIndex>;
+    CheckIndexOverflow<ResolvedIndex, ContainerType>();
+    
+    CheckStride(start, step);
+    
+    const auto last = std::min(stop, static_cast<std::ranges::range_difference_t<ContainerType>>(std::ranges::distance(container)));
+    const auto elements = StridedElements(start, last, step);
+    
+    const auto first = (elements > 0) ? std::ranges::next(std::ranges::begin(container), start) : std::ranges::begin(container);
+    
+    return IteratorCounterRange_strided(Iterator(first, start, step, elements, offset),
+                                        Iterator(first, start, step, 0, offset));
+}
+
+template<typename Index = AutoIndex, typename ContainerType>
+requires std::ranges::bidirectional_range<ContainerType> and std::ranges::borrowed_range<ContainerType>
+constexpr decltype(auto) rcount_strided(ContainerType&& container,
+                                        const std::ranges::range_difference_t<ContainerType>& start,
+                                        const std::ranges::range_difference_t<ContainerType>& stop,
+                                        const std::ranges::range_difference_t<ContainerType>& step = 1,
+                                        const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset = 0)
+{
+    using ResolvedIndex = ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>;
+    using Iterator = StridedIteratorCounter<std::ranges::iterator_t<ContainerType>, ResolvedIndex>;
+    CheckIndexOverflow<ResolvedIndex, ContainerType>();
+    
+    CheckStride(start, step);
+    
+    const auto last = std::min(stop, static_cast<std::ranges::range_difference_t<ContainerType>>(std::ranges::distance(container)));
+    const auto elements = StridedElements(start, last, step);
+    const auto lastElement = (elements > 0) ? start + (elements - 1) * step : start; // Position of the first visited element
+    
+    const auto first = (elements > 0) ? std::ranges::next(std::ranges::begin(container), lastElement) : std::ranges::begin(container);
+    
+    return IteratorCounterRange_strided(Iterator(first, lastElement, -step, elements, offset),
+                                        Iterator(first, lastElement, -step, 0, offset));
+}
+
+//*******************************************************************************
+//                      Asynchronous ranges (coroutines)
+// count_async(asyncRange) enumerates ranges whose begin() and operator++ return awaitables, like cppcoro::async_generator:
+//     auto counted = count_async(produce());
+//     for(auto it = co_await counted.begin(); it != counted.end(); co_await ++it)
+//         auto [value, index] = *it;
+// The counter is stored in the iterator, so it survives suspension points without a separate variable.
+
+// Awaiter of an awaitable: its operator co_await, if it has one, otherwise the awaitable itself
+template<typename AwaitableType>
+constexpr auto GetAwaiter(AwaitableType&& awaitable)
+{
+    if constexpr (requires { std::forward<AwaitableType>(awaitable).operator co_await(); })
+        return std::forward<AwaitableType>(awaitable).operator co_await();
+    else if constexpr (requires { operator co_await(std::forward<AwaitableType>(awaitable)); })
+        return operator co_await(std::forward<AwaitableType>(awaitable));
+    else
+        return AwaitableType(std::forward<AwaitableType>(awaitable));
+}
+
+// Forwards suspension to the awaiter of the underlying range and transforms its result when resumed
+template<typename AwaitableType, typename ResumeFunction>
+class AsyncCounterAwaiter
+{
+private:
+    using AwaiterType = decltype(GetAwaiter(std::declval<AwaitableType>()));
+    
+    AwaiterType m_Awaiter;
+    ResumeFunction m_Resume;
+    
+public:
+    explicit constexpr AsyncCounterAwaiter(AwaitableType&& awaitable, ResumeFunction resume)
+        : m_Awaiter(GetAwaiter(std::forward<AwaitableType>(awaitable)))
+        , m_Resume(std::move(resume))
+    {}
+    
+    constexpr bool await_ready() { return m_Awaiter.await_ready(); }
+    
+    template<typename HandleType>
+    constexpr decltype(auto) await_suspend(HandleType handle) { return m_Awaiter.await_suspend(handle); }
+    
+    constexpr decltype(auto) await_resume() { return m_Resume(m_Awaiter.await_resume()); }
+};
+
+template<typename IteratorType, CounterIndex Index = IndexType>
+class AsyncIteratorCounter
+{
+private:
+    IteratorType m_Iterator;
+    Index m_Counter;
+    
+public:
+    using value_type = std::pair<std::remove_cvref_t<decltype(*std::declval<const IteratorType&>())>, Index>;
+    using reference  = CountedElement<decltype(*std::declval<const IteratorType&>()), Index>;
+    
+    explicit constexpr AsyncIteratorCounter(IteratorType iterator, const Index& offset)
+        : m_Iterator(std::move(iterator))
+        , m_Counter(offset)
+    {}
+    
+    constexpr reference operator*() const { return {*m_Iterator, m_Counter}; }
+    
+    // Awaitable, resumes with a reference to this iterator. The counter is incremented once the next element is available
+    constexpr auto operator++()
+    {
+        return AsyncCounterAwaiter(++m_Iterator, [this](auto&&) -> AsyncIteratorCounter&
+        {
+            ++m_Counter;
+            return *this;
+        });
+    }
+    
+    constexpr const IteratorType& base() const { return m_Iterator; }
+    
+    template<typename SentinelType>
+    requires requires (const IteratorType& it, const SentinelType& sentinel) { { it == sentinel } -> std::convertible_to<bool>; }
+    friend constexpr bool operator==(const AsyncIteratorCounter& it, const CounterSentinel<SentinelType>& sentinel) { return it.m_Iterator == sentinel.base(); }
+};
+
+// Holds the asynchronous range by reference for l-Values and owns it for r-Values (e.g. a generator returned from a coroutine)
+template<typename AsyncRangeType, CounterIndex Index = IndexType>
+class AsyncIteratorCounterRange
+{
+private:
+    using IteratorType = std::remove_cvref_t<decltype(GetAwaiter(std::declval<AsyncRangeType&>().begin()).await_resume())>;
+    
+    AsyncRangeType m_Range;
+    Index m_Offset;
+    
+public:
+    using Iterator = AsyncIteratorCounter<IteratorType, Index>;
+    
+    explicit constexpr AsyncIteratorCounterRange(AsyncRangeType&& range, const Index& offset)
+        : m_Range(std::forward<AsyncRangeType>(range))
+        , m_Offset(offset)
+    {}
+    
+    // Awaitable, resumes with the first iterator
+    constexpr auto begin()
+    {
+        return AsyncCounterAwaiter(m_Range.begin(), [offset = m_Offset](auto&& iterator)
+        {
+            return Iterator(std::forward<decltype(iterator)>(iterator), offset);
+        });
+    }
+    
+    constexpr auto end() { return CounterSentinel<decltype(m_Range.end())>(m_Range.end()); }
+};
+
+template<typename Index = AutoIndex, typename AsyncRangeType>
+requires requires (AsyncRangeType& range) { range.begin(); range.end(); }
+constexpr decltype(auto) count_async(AsyncRangeType&& range, const ResolveIndex<Index, std::ptrdiff_t>& offset = 0)
+{
+    return AsyncIteratorCounterRange<AsyncRangeType, ResolveIndex<Index, std::ptrdiff_t>>(std::forward<AsyncRangeType>(range), offset);
+}
+
+#ifdef RBFL_ENABLE_PARALLEL
+//*******************************************************************************
+// Parallel enumeration with an execution policy (std::execution::par, std::execution::par_unseq, ...).
+// The standard algorithm splits the range into chunks itself. Every element gets its exact index, since
+// the index is derived in O(1) from the position of the iterator (for random access containers).
+// 'function' is called as function(value, index) and must be safe to call concurrently.
+template<typename Index = AutoIndex, typename ExecutionPolicy, typename ContainerType, IndexDirection Direction, typename Function>
+requires std::is_execution_policy_v<std::remove_cvref_t<ExecutionPolicy>>
+void parallel_for_each_counted(ExecutionPolicy&& policy, ContainerType& container, const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset, const Direction& direction, Function function)
+{
+    const auto range = count<Index>(container, offset, direction);
+    
+    // The standard algorithms need an end iterator of the same type. Walks the range once, if its end is a sentinel
+    const auto first = range.begin();
+    const auto last = std::ranges::next(first, range.end());
+    
+    std::for_each(std::forward<ExecutionPolicy>(policy), first, last, [&function](const auto& element)
+    {
+        function(element.value(), element.index());
+    });
+}
+
+template<typename Index = AutoIndex, typename ExecutionPolicy, typename ContainerType, typename Function>
+requires std::is_execution_policy_v<std::remove_cvref_t<ExecutionPolicy>>
+void parallel_for_each_counted(ExecutionPolicy&& policy, ContainerType& container, const ResolveIndex<Index, std::ranges::range_difference_t<ContainerType>>& offset, Function function)
+{
+    parallel_for_each_counted<Index>(std::forward<ExecutionPolicy>(policy), container, offset, ForwardIndex, std::move(function));
+}
+
+template<typename Index = AutoIndex, typename ExecutionPolicy, typename ContainerType, typename Function>
+requires std::is_execution_policy_v<std::remove_cvref_t<ExecutionPolicy>>
+void parallel_for_each_counted(ExecutionPolicy&& policy, ContainerType& container, Function function)
+{
+    parallel_for_each_counted<Index>(std::forward<ExecutionPolicy>(policy), container, 0, ForwardIndex, std::move(function));
+}
+#endif // RBFL_ENABLE_PARALLEL
+
+//*******************************************************************************
+//                      std::ranges view, composable in pipelines
+// Lazy view over another view. Holds only the underlying view, the offset and the direction, so copying is O(1).
+// A reverse index needs the number of elements in advance, which is only possible for forward ranges.
+template<std::ranges::view ViewType, IndexDirection Direction = ForwardIndex_t, CounterIndex Index = IndexType>
+requires std::ranges::input_range<ViewType> and (std::is_same_v<Direction, ForwardIndex_t> or std::ranges::forward_range<ViewType>)
+class IteratorCounterRange_view : public std::ranges::view_interface<IteratorCounterRange_view<ViewType, Direction, Index>>
+{
+private:
+    ViewType  m_Base{};
+    Index m_Offset{};
+    [[no_unique_address]] Direction m_Direction{};
+    
+    template<typename BaseType>
+    static constexpr auto MakeBegin(BaseType& base, const Index& offset, const Direction& direction)
+    {
+        return IteratorCounter<std::ranges::iterator_t<BaseType>, Direction, Index>(std::ranges::begin(base),
+                                                                                    StartIndex(offset, direction, [&]{ return std::ranges::distance(base); }),
+                                                                                    direction);
+    }
+    
+    template<typename BaseType>
+    static constexpr auto MakeEnd(BaseType& base, const Index& offset, const Direction& direction)
+    {
+        using Iterator = IteratorCounter<std::ranges::iterator_t<BaseType>, Direction, Index>;
+        
+        // Give the end iterator its correct index, if that's possible in O(1). Needed for decrementing from the end
+        if constexpr (std::ranges::common_range<BaseType> and std::ranges::sized_range<BaseType>)
+        {
+            const auto size = std::ranges::distance(base);
+            return Iterator(std::ranges::end(base), StartIndex(offset, direction, [&]{ return size; }), direction, size);
+        }
+        else
+            return CounterSentinel<std::ranges::sentinel_t<BaseType>>(std::ranges::end(base));
+    }
+    
+public:
+    IteratorCounterRange_view() requires std::default_initializable<ViewType> = default;
+    
+    explicit constexpr IteratorCounterRange_view(ViewType base, const Index& offset = 0, const Direction& direction = Direction{})
+        : m_Base(std::move(base))
+        , m_Offset(offset)
+        , m_Direction(direction)
+    {}
+    
+    constexpr auto begin() { return MakeBegin(m_Base, m_Offset, m_Direction); }
+    constexpr auto end()   { return MakeEnd(m_Base, m_Offset, m_Direction); }
+    
+    constexpr auto begin() const requires std::ranges::input_range<const ViewType> { return MakeBegin(m_Base, m_Offset, m_Direction); }
+    constexpr auto end()   const requires std::ranges::input_range<const ViewType> { return MakeEnd(m_Base, m_Offset, m_Direction); }
+    
+    constexpr auto size()       requires std::ranges::sized_range<ViewType>       { return std::ranges::size(m_Base); }
+    constexpr auto size() const requires std::ranges::sized_range<const ViewType> { return std::ranges::size(m_Base); }
+    
+    constexpr ViewType base() const& requires std::copy_constructible<ViewType> { return m_Base; }
+    constexpr ViewType base() && { return std::move(m_Base); }
+};
+
+template<typename RangeType>
+IteratorCounterRange_view(RangeType&&) -> IteratorCounterRange_view<std::views::all_t<RangeType>, ForwardIndex_t, ResolveIndex<AutoIndex, std::ranges::range_difference_t<RangeType>>>;
+
+template<typename RangeType, CounterIndex Index, IndexDirection Direction = ForwardIndex_t>
+IteratorCounterRange_view(RangeType&&, const Index&, const Direction& = Direction{}) -> IteratorCounterRange_view<std::views::all_t<RangeType>, Direction, Index>;
+
+namespace views
+{
+// Partially applied adaptor, created by counted_enumerate(offset, direction) for use in pipelines
+template<typename Index, IndexDirection Direction>
+struct CountedEnumerateClosure
+{
+    ResolveIndex<Index, std::ptrdiff_t> offset;
+    [[no_unique_address]] Direction direction;
+    
+    template<std::ranges::viewable_range RangeType>
+    friend constexpr auto operator|(RangeType&& range, const CountedEnumerateClosure& closure)
+    {
+        using ResolvedIndex = ResolveIndex<Index, std::ranges::range_difference_t<RangeType>>;
+        return IteratorCounterRange_view(std::forward<RangeType>(range), static_cast<ResolvedIndex>(closure.offset), closure.direction);
+    }
+};
+
+template<typename Index = AutoIndex>
+struct CountedEnumerateAdaptor
+{
+    template<std::ranges::viewable_range RangeType, IndexDirection Direction = ForwardIndex_t>
+    constexpr auto operator()(RangeType&& range, const ResolveIndex<Index, std::ranges::range_difference_t<RangeType>>& offset = 0, const Direction& direction = Direction{}) const
+    {
+        return IteratorCounterRange_view(std::forward<RangeType>(range), offset, direction);
+    }
+    
+    template<IndexDirection Direction = ForwardIndex_t>
+    constexpr auto operator()(const ResolveIndex<Index, std::ptrdiff_t>& offset = 0, const Direction& direction = Direction{}) const
+    {
+        return CountedEnumerateClosure<Index, Direction>{offset, direction};
+    }
+    
+    template<std::ranges::viewable_range RangeType>
+    friend constexpr auto operator|(RangeType&& range, const CountedEnumerateAdaptor&)
+    {
+        return IteratorCounterRange_view(std::forward<RangeType>(range), ResolveIndex<Index, std::ranges::range_difference_t<RangeType>>{0});
+    }
+};
+
+// Usage: data | std::views::filter(f) | RBFLCounter::views::counted_enumerate(100) | std::views::take(n)
+inline constexpr CountedEnumerateAdaptor counted_enumerate{};
+inline constexpr CountedEnumerateAdaptor with_counter{}; // Short alias
+
+// With a specific index type: data | RBFLCounter::views::counted_enumerate_as<std::int32_t>(100)
+template<CounterIndex Index>
+inline constexpr CountedEnumerateAdaptor<Index> counted_enumerate_as{};
+} // views
+
+} // RBFLCounter
+
+// Tuple protocol of CountedElement, for structured bindings
+template<typename ReferenceType, typename Index>
+struct std::tuple_size<RBFLCounter::CountedElement<ReferenceType, Index>> : std::integral_constant<std::size_t, 2> {};
+
+template<typename ReferenceType, typename Index>
+struct std::tuple_element<0, RBFLCounter::CountedElement<ReferenceType, Index>> { using type = ReferenceType; };
+
+template<typename ReferenceType, typename Index>
+struct std::tuple_element<1, RBFLCounter::CountedElement<ReferenceType, Index>> { using type = Index; };
+
+// Common reference of the proxy and the value_type of the iterators (std::pair), needed for std::indirectly_readable
+template<typename ReferenceType, typename Index, typename ValueType, template<typename> typename TQual, template<typename> typename UQual>
+struct std::basic_common_reference<RBFLCounter::CountedElement<ReferenceType, Index>, std::pair<ValueType, Index>, TQual, UQual>
+{
+    using type = std::pair<ValueType, Index>;
+};
+
+template<typename ReferenceType, typename Index, typename ValueType, template<typename> typename TQual, template<typename> typename UQual>
+struct std::basic_common_reference<std::pair<ValueType, Index>, RBFLCounter::CountedElement<ReferenceType, Index>, TQual, UQual>
+{
+    using type = std::pair<ValueType, Index>;
+};
+
+// The view is borrowed if the underlying view is, since it stores nothing else that iterators refer to
+template<typename ViewType, typename Direction, typename Index>
+inline constexpr bool std::ranges::enable_borrowed_range<RBFLCounter::IteratorCounterRange_view<ViewType, Direction, Index>> = std::ranges::enable_borrowed_range<ViewType>;
+
+// l-Value ranges don't own the elements, iterators stay valid after the range is gone.
+// Not with instrumentation: instrumented iterators point to the statistics stored in the range
+template<typename IteratorType, typename Direction, typename Index, typename SentinelType, typename SizeType>
+inline constexpr bool std::ranges::enable_borrowed_range<RBFLCounter::IteratorCounterRange_lval<IteratorType, Direction, Index, SentinelType, RBFLCounter::NoInstrumentation, SizeType>> = true;
+
+// Chunk ranges only hold a std::span
+template<typename T, bool ReverseElements, typename Index>
+inline constexpr bool std::ranges::enable_borrowed_range<RBFLCounter::ChunkCounterRange<T, ReverseElements, Index>> = true;
 
 #endif // RANGE_FOR_LOOP_WITH_COUNTER_H